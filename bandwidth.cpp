@@ -0,0 +1,89 @@
+#include "bandwidth.h"
+
+#include <emmintrin.h>
+
+// Every kernel is unrolled by four vectors, so lengths are rounded down to a
+// multiple of 64 bytes.
+#define UNROLL_BYTES 64
+
+uint64_t bandwidth_read(uint8_t *arr, uint64_t length, uint64_t n_passes) {
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  __m128i acc2 = _mm_setzero_si128();
+  __m128i acc3 = _mm_setzero_si128();
+  uint64_t end = length / UNROLL_BYTES * UNROLL_BYTES;
+  for (uint64_t pass = 0; pass < n_passes; pass++) {
+    for (uint64_t i = 0; i < end; i += UNROLL_BYTES) {
+      auto ptr = (__m128i *)(arr + i);
+      acc0 = _mm_xor_si128(acc0, _mm_load_si128(ptr));
+      acc1 = _mm_xor_si128(acc1, _mm_load_si128(ptr + 1));
+      acc2 = _mm_xor_si128(acc2, _mm_load_si128(ptr + 2));
+      acc3 = _mm_xor_si128(acc3, _mm_load_si128(ptr + 3));
+    }
+  }
+  __m128i acc = _mm_xor_si128(_mm_xor_si128(acc0, acc1),
+                              _mm_xor_si128(acc2, acc3));
+  return (uint64_t)_mm_cvtsi128_si64(acc);
+}
+
+uint64_t bandwidth_write(uint8_t *arr, uint64_t length, uint64_t n_passes) {
+  uint64_t end = length / UNROLL_BYTES * UNROLL_BYTES;
+  for (uint64_t pass = 0; pass < n_passes; pass++) {
+    __m128i value = _mm_set1_epi64x(pass);
+    for (uint64_t i = 0; i < end; i += UNROLL_BYTES) {
+      auto ptr = (__m128i *)(arr + i);
+      _mm_store_si128(ptr, value);
+      _mm_store_si128(ptr + 1, value);
+      _mm_store_si128(ptr + 2, value);
+      _mm_store_si128(ptr + 3, value);
+    }
+  }
+  return arr[0];
+}
+
+uint64_t bandwidth_rmw(uint8_t *arr, uint64_t length, uint64_t n_passes) {
+  uint64_t end = length / UNROLL_BYTES * UNROLL_BYTES;
+  __m128i one = _mm_set1_epi64x(1);
+  for (uint64_t pass = 0; pass < n_passes; pass++) {
+    for (uint64_t i = 0; i < end; i += UNROLL_BYTES) {
+      auto ptr = (__m128i *)(arr + i);
+      _mm_store_si128(ptr, _mm_add_epi64(_mm_load_si128(ptr), one));
+      _mm_store_si128(ptr + 1, _mm_add_epi64(_mm_load_si128(ptr + 1), one));
+      _mm_store_si128(ptr + 2, _mm_add_epi64(_mm_load_si128(ptr + 2), one));
+      _mm_store_si128(ptr + 3, _mm_add_epi64(_mm_load_si128(ptr + 3), one));
+    }
+  }
+  return arr[0];
+}
+
+uint64_t bandwidth_copy(uint8_t *arr, uint64_t length, uint64_t n_passes) {
+  uint64_t half = length / 2 / UNROLL_BYTES * UNROLL_BYTES;
+  uint8_t *dst = arr + half;
+  for (uint64_t pass = 0; pass < n_passes; pass++) {
+    for (uint64_t i = 0; i < half; i += UNROLL_BYTES) {
+      auto src_ptr = (__m128i *)(arr + i);
+      auto dst_ptr = (__m128i *)(dst + i);
+      _mm_store_si128(dst_ptr, _mm_load_si128(src_ptr));
+      _mm_store_si128(dst_ptr + 1, _mm_load_si128(src_ptr + 1));
+      _mm_store_si128(dst_ptr + 2, _mm_load_si128(src_ptr + 2));
+      _mm_store_si128(dst_ptr + 3, _mm_load_si128(src_ptr + 3));
+    }
+  }
+  return dst[0];
+}
+
+uint64_t bandwidth_nt_write(uint8_t *arr, uint64_t length, uint64_t n_passes) {
+  uint64_t end = length / UNROLL_BYTES * UNROLL_BYTES;
+  for (uint64_t pass = 0; pass < n_passes; pass++) {
+    __m128i value = _mm_set1_epi64x(pass);
+    for (uint64_t i = 0; i < end; i += UNROLL_BYTES) {
+      auto ptr = (__m128i *)(arr + i);
+      _mm_stream_si128(ptr, value);
+      _mm_stream_si128(ptr + 1, value);
+      _mm_stream_si128(ptr + 2, value);
+      _mm_stream_si128(ptr + 3, value);
+    }
+  }
+  _mm_sfence();
+  return arr[0];
+}
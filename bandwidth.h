@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+// Streaming kernels used by the bandwidth mode. Each kernel walks `length`
+// bytes starting at the 16-byte aligned `arr` `n_passes` times with 16-byte
+// SSE2 accesses and returns a value derived from the data, so that the
+// compiler cannot drop the loads.
+typedef uint64_t (*BandwidthKernel)(uint8_t *arr, uint64_t length,
+                                    uint64_t n_passes);
+
+uint64_t bandwidth_read(uint8_t *arr, uint64_t length, uint64_t n_passes);
+uint64_t bandwidth_write(uint8_t *arr, uint64_t length, uint64_t n_passes);
+uint64_t bandwidth_rmw(uint8_t *arr, uint64_t length, uint64_t n_passes);
+// Copies the first half of the buffer into the second half
+uint64_t bandwidth_copy(uint8_t *arr, uint64_t length, uint64_t n_passes);
+// Like bandwidth_write, but with stores that bypass the caches
+uint64_t bandwidth_nt_write(uint8_t *arr, uint64_t length, uint64_t n_passes);
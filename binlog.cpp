@@ -0,0 +1,128 @@
+#include "binlog.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INITIAL_CAPACITY (1024 * 1024)
+
+static uint8_t *map_file(int fd, uint64_t length, int prot) {
+  void *map = mmap(nullptr, length, prot, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    std::cerr << "Failed to map " << length << " bytes of a binlog"
+              << std::endl;
+    std::exit(1);
+  }
+  return (uint8_t *)map;
+}
+
+Binlog create_binlog(std::string const &path, BinlogKind kind,
+                     uint32_t record_size) {
+  Binlog binlog;
+  binlog.fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (binlog.fd < 0 || ftruncate(binlog.fd, INITIAL_CAPACITY) != 0) {
+    std::cerr << "Failed to create " << path << std::endl;
+    std::exit(1);
+  }
+  binlog.capacity = INITIAL_CAPACITY;
+  binlog.writable = true;
+  binlog.map = map_file(binlog.fd, binlog.capacity, PROT_READ | PROT_WRITE);
+  auto header = (BinlogHeader *)binlog.map;
+  header->magic = BINLOG_MAGIC;
+  header->kind = kind;
+  header->record_size = record_size;
+  header->n_records = 0;
+  return binlog;
+}
+
+Binlog try_open_binlog(std::string const &path) {
+  Binlog binlog;
+  binlog.fd = open(path.c_str(), O_RDONLY);
+  struct stat status;
+  if (binlog.fd < 0 || fstat(binlog.fd, &status) != 0) {
+    std::cerr << "Failed to open " << path << std::endl;
+    if (binlog.fd >= 0) {
+      close(binlog.fd);
+    }
+    return Binlog();
+  }
+  binlog.capacity = status.st_size;
+  if (binlog.capacity < sizeof(BinlogHeader)) {
+    std::cerr << path << " is not a binlog" << std::endl;
+    close(binlog.fd);
+    return Binlog();
+  }
+  binlog.map = map_file(binlog.fd, binlog.capacity, PROT_READ);
+  auto const &header = get_header(binlog);
+  if (header.magic != BINLOG_MAGIC ||
+      sizeof(BinlogHeader) + header.n_records * header.record_size >
+          binlog.capacity) {
+    std::cerr << path << " is not a binlog or was cut short" << std::endl;
+    close_binlog(binlog);
+    return Binlog();
+  }
+  return binlog;
+}
+
+Binlog open_binlog(std::string const &path) {
+  auto binlog = try_open_binlog(path);
+  if (!is_open(binlog)) {
+    std::exit(1);
+  }
+  return binlog;
+}
+
+bool is_open(Binlog const &binlog) { return binlog.map != nullptr; }
+
+BinlogHeader const &get_header(Binlog const &binlog) {
+  return *(BinlogHeader const *)binlog.map;
+}
+
+void *append_record(Binlog &binlog) {
+  auto header = (BinlogHeader *)binlog.map;
+  uint64_t used =
+      sizeof(BinlogHeader) + header->n_records * header->record_size;
+  if (used + header->record_size > binlog.capacity) {
+    uint64_t capacity = 2 * binlog.capacity;
+    if (ftruncate(binlog.fd, capacity) != 0) {
+      std::cerr << "Failed to grow a binlog to " << capacity << " bytes"
+                << std::endl;
+      std::exit(1);
+    }
+    void *map = mremap(binlog.map, binlog.capacity, capacity, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+      std::cerr << "Failed to map " << capacity << " bytes of a binlog"
+                << std::endl;
+      std::exit(1);
+    }
+    binlog.map = (uint8_t *)map;
+    binlog.capacity = capacity;
+    header = (BinlogHeader *)binlog.map;
+  }
+  header->n_records++;
+  return binlog.map + used;
+}
+
+void const *get_record(Binlog const &binlog, uint64_t index) {
+  auto const &header = get_header(binlog);
+  return binlog.map + sizeof(BinlogHeader) + index * header.record_size;
+}
+
+void close_binlog(Binlog &binlog) {
+  if (!is_open(binlog)) {
+    return;
+  }
+  auto const &header = get_header(binlog);
+  uint64_t used = sizeof(BinlogHeader) + header.n_records * header.record_size;
+  munmap(binlog.map, binlog.capacity);
+  if (binlog.writable && ftruncate(binlog.fd, used) != 0) {
+    std::cerr << "Failed to trim a binlog to " << used << " bytes"
+              << std::endl;
+  }
+  close(binlog.fd);
+  binlog = Binlog();
+}
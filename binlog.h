@@ -0,0 +1,76 @@
+#pragma once
+
+// Fixed-size records in a flat file that is written and read through mmap,
+// for sweeps with too many points for a text stream
+
+#include <cstdint>
+#include <string>
+
+#define BINLOG_MAGIC 0x31474f4c4e494255ULL // "UBINLOG1"
+
+enum class BinlogKind : uint32_t { Results = 1, Trace = 2 };
+
+struct BinlogHeader {
+  uint64_t magic;
+  BinlogKind kind;
+  uint32_t record_size;
+  uint64_t n_records;
+};
+
+// One CSV row of main. The name is NUL-terminated, so at most 39 characters
+// of it are kept.
+struct ResultRecord {
+  char benchmark[40];
+  int32_t threads;
+  int32_t stride;
+  uint64_t arr_size;
+  double result;
+  double increase;
+};
+
+// The records are the on-disk format, files written by other builds have to
+// stay readable
+static_assert(sizeof(BinlogHeader) == 24);
+static_assert(sizeof(ResultRecord) == 72);
+
+// One node of a chain: the byte offset of the `index`-th node visited, from
+// the start of the arena, in the `point`-th chain that was traced
+struct TraceRecord {
+  uint32_t point;
+  uint32_t index;
+  uint64_t offset;
+};
+
+static_assert(sizeof(TraceRecord) == 16);
+
+struct Binlog {
+  int fd = -1;
+  uint8_t *map = nullptr;
+  // Bytes mapped, of which the header and n_records records are used
+  uint64_t capacity = 0;
+  bool writable = false;
+};
+
+// Creates or truncates `path`. Exits on failure, like the rest of main.
+Binlog create_binlog(std::string const &path, BinlogKind kind,
+                     uint32_t record_size);
+
+// Maps an existing file read-only. Exits if it is not a binlog.
+Binlog open_binlog(std::string const &path);
+
+// Like open_binlog, but says why and returns a binlog that is not open
+// instead of exiting
+Binlog try_open_binlog(std::string const &path);
+
+bool is_open(Binlog const &binlog);
+
+BinlogHeader const &get_header(Binlog const &binlog);
+
+// Space for one more record, valid until the next append. The file grows by
+// doubling, so appends are amortized O(1) and never go through write().
+void *append_record(Binlog &binlog);
+
+void const *get_record(Binlog const &binlog, uint64_t index);
+
+// Trims a written file to its records and unmaps it
+void close_binlog(Binlog &binlog);
@@ -0,0 +1,359 @@
+#include "cachegeom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <unistd.h>
+#include <x86intrin.h>
+#include <vector>
+
+#define MAX_ASSOCIATIVITY 32
+
+// Line size probe: more than L1 and less than L2 on every core we know of
+#define LINE_FOOTPRINT (256 * 1024)
+#define LINE_BLOCK_SIZE (4 * CACHEGEOM_MAX_CACHELINE_SIZE)
+
+// Percent of the budget that calibrates the TSC, and at most how long
+#define TSC_CALIBRATION_SHARE 2
+#define TSC_CALIBRATION_MAX_NS 2000000
+
+// Latency between the fastest and the slowest point that separates hits
+// from misses
+#define KNEE_FRACTION 0.5
+// How much slower than the fastest point the slowest has to be for a knee,
+// an L2 hit costs about three times an L1 hit
+#define KNEE_MIN_RATIO 1.5
+// Standard errors every point may be off by when the range of a knee is
+// worked out
+#define KNEE_ERROR_FACTOR 2
+
+// Fallbacks for hosts where the OS reports nothing
+#define DEFAULT_CACHESIZE (32 * 1024)
+
+namespace cachegeom {
+
+// Keeps the chase from being optimized away
+static volatile uint64_t sink;
+
+uint64_t generate_chain(volatile uint8_t *arr, int stride, uint64_t size) {
+  uint64_t n_nodes = size / stride;
+  for (uint64_t i = 0; i < n_nodes; i++) {
+    *(volatile uint64_t *)(arr + i * stride) =
+        (uint64_t)(arr + (i + 1) % n_nodes * stride);
+  }
+  return n_nodes;
+}
+
+uint64_t generate_random_chain(volatile uint8_t *arr, int stride,
+                               uint64_t size) {
+  uint64_t n_nodes = size / stride;
+  std::vector<uint64_t> order(n_nodes);
+  std::iota(order.begin(), order.end(), 0);
+  std::mt19937_64 generator(CACHEGEOM_RANDOM_CHAIN_SEED);
+  std::shuffle(order.begin() + 1, order.end(), generator);
+  for (uint64_t i = 0; i < n_nodes; i++) {
+    *(volatile uint64_t *)(arr + order[i] * stride) =
+        (uint64_t)(arr + order[(i + 1) % n_nodes] * stride);
+  }
+  return n_nodes;
+}
+
+uint64_t generate_pair_chain(volatile uint8_t *arr, int distance,
+                             uint64_t size) {
+  uint64_t n_blocks = size / LINE_BLOCK_SIZE;
+  std::vector<uint64_t> order(n_blocks);
+  std::iota(order.begin(), order.end(), 0);
+  std::mt19937_64 generator(CACHEGEOM_RANDOM_CHAIN_SEED);
+  std::shuffle(order.begin() + 1, order.end(), generator);
+  for (uint64_t i = 0; i < n_blocks; i++) {
+    volatile uint8_t *block = arr + order[i] * LINE_BLOCK_SIZE;
+    volatile uint8_t *second = block + distance;
+    *(volatile uint64_t *)block = (uint64_t)second;
+    *(volatile uint64_t *)second =
+        (uint64_t)(arr + order[(i + 1) % n_blocks] * LINE_BLOCK_SIZE);
+  }
+  return 2 * n_blocks;
+}
+
+// The second access of a block hits as long as it is in the same line as
+// the first one, so the cost per access jumps once the distance between them
+// reaches the line size. The chain lives in L2, where the adjacent-line
+// prefetcher of the L2 does not blur the jump as it does in DRAM.
+Phase get_line_phase() {
+  Phase phase = {PhaseKind::Line, {}, generate_pair_chain};
+  for (int distance = CACHEGEOM_MIN_CACHELINE_SIZE / 2;
+       distance <= 2 * CACHEGEOM_MAX_CACHELINE_SIZE; distance *= 2) {
+    phase.points.push_back({distance, LINE_FOOTPRINT});
+  }
+  return phase;
+}
+
+// A random chain over one line per node hits while it fits and starts
+// missing right after, whatever the replacement policy
+Phase get_size_phase(int cache_line_size, uint64_t min_size) {
+  Phase phase = {PhaseKind::Size, {}, generate_random_chain};
+  for (uint64_t size = min_size; size <= CACHEGEOM_MAX_CACHESIZE;
+       size += CACHEGEOM_CACHESIZE_STEP) {
+    phase.points.push_back({cache_line_size, size});
+  }
+  return phase;
+}
+
+// Nodes MAX_N_SETS lines apart all map to one set, so the chain starts
+// missing as soon as it has more nodes than the set has ways
+Phase get_associativity_phase(int cache_line_size) {
+  int stride = cache_line_size * CACHEGEOM_MAX_N_SETS;
+  Phase phase = {PhaseKind::Associativity, {}, generate_random_chain};
+  for (uint64_t n_nodes = 1; n_nodes <= MAX_ASSOCIATIVITY; n_nodes++) {
+    phase.points.push_back({stride, n_nodes * stride});
+  }
+  return phase;
+}
+
+// Index of the last measured point before the first one that `is_miss`
+// holds for, -1 if there is none
+static int find_last_before(std::vector<double> const &latencies,
+                            std::function<bool(size_t)> const &is_miss) {
+  int last = -1;
+  for (size_t i = 0; i < latencies.size(); i++) {
+    if (is_miss(i)) {
+      break;
+    }
+    if (!std::isnan(latencies[i])) {
+      last = i;
+    }
+  }
+  return last;
+}
+
+// The value `phase` detects if the point at `last` is the last one before
+// the knee, clamped to the sweep
+static double get_value(Phase const &phase, int last) {
+  auto const &points = phase.points;
+  switch (phase.kind) {
+  case PhaseKind::Line:
+    // The first distance past the knee is the first one in another line
+    return points[std::clamp(last + 1, 0, (int)points.size() - 1)].stride;
+  case PhaseKind::Size:
+    return points[std::max(last, 0)].size;
+  case PhaseKind::Associativity: {
+    auto const &point = points[std::max(last, 0)];
+    return point.size / point.stride;
+  }
+  }
+  return 0;
+}
+
+// The knee is where the latency first climbs past the midpoint between the
+// fastest and the slowest measured point
+Detection find_knee(Phase const &phase, std::vector<double> const &latencies,
+                    std::vector<double> const &errors) {
+  double fastest = std::numeric_limits<double>::infinity();
+  double slowest = -fastest;
+  int n_measured = 0;
+  for (double latency : latencies) {
+    if (!std::isnan(latency)) {
+      fastest = std::min(fastest, latency);
+      slowest = std::max(slowest, latency);
+      n_measured++;
+    }
+  }
+  // A curve this flat has no knee
+  if (n_measured < 2 || slowest < KNEE_MIN_RATIO * fastest) {
+    return {0, 0, 0, 0};
+  }
+  double knee = fastest + (slowest - fastest) * KNEE_FRACTION;
+  auto get_margin = [&](size_t i) {
+    bool known = i < errors.size() && std::isfinite(errors[i]);
+    return known ? KNEE_ERROR_FACTOR * errors[i] : 0;
+  };
+  int last = find_last_before(
+      latencies, [&](size_t i) { return latencies[i] > knee; });
+  int last_low = find_last_before(latencies, [&](size_t i) {
+    return latencies[i] + get_margin(i) > knee;
+  });
+  int last_high = find_last_before(latencies, [&](size_t i) {
+    return latencies[i] - get_margin(i) > knee;
+  });
+  if (last < 0 || (phase.kind == PhaseKind::Line &&
+                   last + 1 == (int)phase.points.size())) {
+    return {0, 0, 0, 0};
+  }
+  return {get_value(phase, last), get_value(phase, last_low),
+          get_value(phase, last_high), slowest / fastest / KNEE_MIN_RATIO};
+}
+
+double calibrate_tsc(std::chrono::nanoseconds duration) {
+  auto start = Clock::now();
+  uint64_t start_tsc = __rdtsc();
+  while (Clock::now() < start + duration) {
+  }
+  uint64_t end_tsc = __rdtsc();
+  double elapsed_ns =
+      std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  return (end_tsc - start_tsc) / elapsed_ns;
+}
+
+double time_chase(volatile uint8_t *arr, uint64_t n_accesses,
+                  double tsc_per_ns) {
+  volatile uint8_t *value = arr;
+  unsigned int aux;
+  _mm_lfence();
+  uint64_t start = __rdtsc();
+  for (uint64_t i = 0; i < n_accesses; i++) {
+    value = (volatile uint8_t *)*(volatile uint64_t *)value;
+  }
+  uint64_t end = __rdtscp(&aux);
+  sink = (uint64_t)value;
+  return (end - start) / tsc_per_ns;
+}
+
+double get_standard_error(std::vector<double> const &samples) {
+  if (samples.size() < 2) {
+    return 0;
+  }
+  double mean = std::accumulate(samples.begin(), samples.end(), 0.0) /
+                samples.size();
+  double sum_of_squares = 0;
+  for (double sample : samples) {
+    sum_of_squares += (sample - mean) * (sample - mean);
+  }
+  return std::sqrt(sum_of_squares / (samples.size() - 1) / samples.size());
+}
+
+double sample_until_deadline(std::function<double()> const &run,
+                             Clock::time_point deadline,
+                             std::vector<double> &samples) {
+  size_t n_before = samples.size();
+  do {
+    samples.push_back(run());
+  } while (samples.size() - n_before < 2 || Clock::now() < deadline);
+  return std::accumulate(samples.begin() + n_before, samples.end(), 0.0) /
+         (samples.size() - n_before);
+}
+
+// Deadline of the next of `n_points_left` points that share the time until
+// `deadline` equally
+static Clock::time_point next_point_deadline(Clock::time_point deadline,
+                                             size_t n_points_left) {
+  auto now = Clock::now();
+  return deadline <= now ? now
+                         : now + (deadline - now) / (long)n_points_left;
+}
+
+Detection run_phase(volatile uint8_t *arr, Phase const &phase,
+                    double tsc_per_ns, Clock::time_point deadline) {
+  std::vector<double> latencies;
+  std::vector<double> errors;
+  for (size_t i = 0; i < phase.points.size(); i++) {
+    if (Clock::now() >= deadline) {
+      return {0, 0, 0, 0};
+    }
+    phase.generate(arr, phase.points[i].stride, phase.points[i].size);
+    std::vector<double> samples;
+    latencies.push_back(sample_until_deadline(
+        [&]() {
+          return time_chase(arr, CACHEGEOM_RUN_N_ACCESSES, tsc_per_ns) /
+                 CACHEGEOM_RUN_N_ACCESSES;
+        },
+        next_point_deadline(deadline, phase.points.size() - i), samples));
+    errors.push_back(get_standard_error(samples));
+  }
+  return find_knee(phase, latencies, errors);
+}
+
+static long sysconf_or(int name, long fallback) {
+  long value = sysconf(name);
+  return value > 0 ? value : fallback;
+}
+
+CacheGeometry detect(std::chrono::milliseconds budget) {
+  auto start = Clock::now();
+  auto deadline = start + budget;
+  CacheGeometry geometry;
+  geometry.cache_line_size = sysconf_or(_SC_LEVEL1_DCACHE_LINESIZE,
+                                        CACHEGEOM_DEFAULT_CACHELINE_SIZE);
+  geometry.cache_size = sysconf_or(_SC_LEVEL1_DCACHE_SIZE, DEFAULT_CACHESIZE);
+  geometry.associativity =
+      sysconf_or(_SC_LEVEL1_DCACHE_ASSOC, CACHEGEOM_DEFAULT_ASSOCIATIVITY);
+  geometry.cache_line_size_range = {geometry.cache_line_size,
+                                   geometry.cache_line_size};
+  geometry.cache_size_range = {geometry.cache_size, geometry.cache_size};
+  geometry.associativity_range = {geometry.associativity,
+                                  geometry.associativity};
+  geometry.line_measured = false;
+  geometry.size_measured = false;
+  geometry.associativity_measured = false;
+  geometry.probed = false;
+
+  uint8_t *arr = (uint8_t *)aligned_alloc(sysconf_or(_SC_PAGE_SIZE, 4096),
+                                          CACHEGEOM_ARENA_SIZE);
+  if (arr != nullptr) {
+    geometry.probed = true;
+    std::memset(arr, 0, CACHEGEOM_ARENA_SIZE);
+    auto line_deadline = start + budget * CACHEGEOM_LINE_BUDGET_SHARE / 100;
+    auto size_deadline =
+        line_deadline + budget * CACHEGEOM_SIZE_BUDGET_SHARE / 100;
+    // Taken out of the line phase's share
+    double tsc_per_ns = calibrate_tsc(std::min<std::chrono::nanoseconds>(
+        budget * TSC_CALIBRATION_SHARE / 100,
+        std::chrono::nanoseconds(TSC_CALIBRATION_MAX_NS)));
+
+    auto line = run_phase(arr, get_line_phase(), tsc_per_ns, line_deadline);
+    if (line.value != 0) {
+      geometry.cache_line_size = line.value;
+      geometry.cache_line_size_range = {(int)line.low, (int)line.high};
+      geometry.line_measured = true;
+    }
+    auto size = run_phase(arr, get_size_phase(geometry.cache_line_size),
+                          tsc_per_ns, size_deadline);
+    if (size.value != 0) {
+      geometry.cache_size = size.value;
+      geometry.cache_size_range = {(uint64_t)size.low, (uint64_t)size.high};
+      geometry.size_measured = true;
+    }
+    auto ways =
+        run_phase(arr, get_associativity_phase(geometry.cache_line_size),
+                  tsc_per_ns, deadline);
+    if (ways.value != 0) {
+      geometry.associativity = ways.value;
+      geometry.associativity_range = {(int)ways.low, (int)ways.high};
+      geometry.associativity_measured = true;
+    }
+    free(arr);
+  }
+  geometry.elapsed = Clock::now() - start;
+  return geometry;
+}
+
+} // namespace cachegeom
+
+int cachegeom_detect(uint32_t budget_ms, struct cachegeom_geometry *geometry) {
+  auto detected = cachegeom::detect(std::chrono::milliseconds(budget_ms));
+  if (!detected.probed) {
+    return -1;
+  }
+  geometry->cache_line_size = detected.cache_line_size;
+  geometry->cache_size = detected.cache_size;
+  geometry->associativity = detected.associativity;
+  geometry->measured =
+      (detected.line_measured ? CACHEGEOM_LINE_MEASURED : 0) |
+      (detected.size_measured ? CACHEGEOM_SIZE_MEASURED : 0) |
+      (detected.associativity_measured ? CACHEGEOM_ASSOCIATIVITY_MEASURED
+                                       : 0);
+  geometry->cache_line_size_range[0] = detected.cache_line_size_range.low;
+  geometry->cache_line_size_range[1] = detected.cache_line_size_range.high;
+  geometry->cache_size_range[0] = detected.cache_size_range.low;
+  geometry->cache_size_range[1] = detected.cache_size_range.high;
+  geometry->associativity_range[0] = detected.associativity_range.low;
+  geometry->associativity_range[1] = detected.associativity_range.high;
+  geometry->elapsed_ms =
+      std::chrono::duration<double, std::milli>(detected.elapsed).count();
+  int all_measured = CACHEGEOM_LINE_MEASURED | CACHEGEOM_SIZE_MEASURED |
+                     CACHEGEOM_ASSOCIATIVITY_MEASURED;
+  return geometry->measured == all_measured ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+// libcachegeom: L1 data cache geometry detection for programs that size
+// their data at startup. Every phase fits into a wall-clock budget; whatever
+// could not be measured in time is taken from the OS instead and marked as
+// such. Measured values come with the range the noise of their points
+// leaves them.
+
+#include <stdint.h>
+
+// Probe buffer, larger than the L2 of any core we know of
+#define CACHEGEOM_ARENA_SIZE (16 * 1024 * 1024)
+
+// Search bounds, shared with main's geometry mode so that both look for the
+// same geometries
+#define CACHEGEOM_MIN_CACHELINE_SIZE 16
+#define CACHEGEOM_MAX_CACHELINE_SIZE 128
+#define CACHEGEOM_MIN_CACHESIZE (32 * 1024)
+#define CACHEGEOM_MAX_CACHESIZE (70 * 1024)
+#define CACHEGEOM_CACHESIZE_STEP (2 * 1024)
+#define CACHEGEOM_MAX_N_SETS 128
+
+// Also main's: the line size and associativity assumed where the OS reports
+// none and the seed of every random chain
+#define CACHEGEOM_DEFAULT_CACHELINE_SIZE 64
+#define CACHEGEOM_DEFAULT_ASSOCIATIVITY 8
+#define CACHEGEOM_RANDOM_CHAIN_SEED 42
+
+// Budgeted runs, main's included: accesses per TSC-timed run, long enough
+// to hide the timer reads and short enough for many runs per point even
+// with a 100 ms budget, and the percent of the budget the line and the size
+// phase get. Associativity gets the rest.
+#define CACHEGEOM_RUN_N_ACCESSES 4096
+#define CACHEGEOM_LINE_BUDGET_SHARE 30
+#define CACHEGEOM_SIZE_BUDGET_SHARE 40
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CACHEGEOM_LINE_MEASURED 1
+#define CACHEGEOM_SIZE_MEASURED 2
+#define CACHEGEOM_ASSOCIATIVITY_MEASURED 4
+
+struct cachegeom_geometry {
+  int32_t cache_line_size;
+  uint64_t cache_size;
+  int32_t associativity;
+  // CACHEGEOM_*_MEASURED flags of the fields that were measured
+  int32_t measured;
+  double elapsed_ms;
+  // Lowest and highest value each measured field could have, at two
+  // standard errors of the points around its knee. Both are the value
+  // itself for OS values.
+  int32_t cache_line_size_range[2];
+  uint64_t cache_size_range[2];
+  int32_t associativity_range[2];
+};
+
+// Fills `geometry` within about `budget_ms` milliseconds. Returns 0 if
+// everything was measured, 1 if some fields are the OS values and -1 if the
+// probe buffer could not be allocated.
+int cachegeom_detect(uint32_t budget_ms, struct cachegeom_geometry *geometry);
+
+#ifdef __cplusplus
+}
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace cachegeom {
+
+typedef std::chrono::steady_clock Clock;
+
+template <typename T> struct Range {
+  T low;
+  T high;
+};
+
+struct CacheGeometry {
+  int cache_line_size;
+  uint64_t cache_size;
+  int associativity;
+  // As in cachegeom_geometry
+  Range<int> cache_line_size_range;
+  Range<uint64_t> cache_size_range;
+  Range<int> associativity_range;
+  bool line_measured;
+  bool size_measured;
+  bool associativity_measured;
+  // False if the probe buffer could not be allocated
+  bool probed;
+  std::chrono::nanoseconds elapsed;
+};
+
+// Link nodes `stride` bytes apart over the first `size` bytes of `arr` into
+// one cycle that starts at `arr`, and return the number of nodes.
+// generate_chain visits them in address order, generate_random_chain in a
+// fixed random one that neither the stride nor the page prefetchers can run
+// ahead of.
+uint64_t generate_chain(volatile uint8_t *arr, int stride, uint64_t size);
+uint64_t generate_random_chain(volatile uint8_t *arr, int stride,
+                               uint64_t size);
+
+// Visits blocks of 4 * CACHEGEOM_MAX_CACHELINE_SIZE bytes in random order,
+// each at its start and then `distance` bytes further
+uint64_t generate_pair_chain(volatile uint8_t *arr, int distance,
+                             uint64_t size);
+
+typedef uint64_t (*ChainGenerator)(volatile uint8_t *arr, int stride,
+                                   uint64_t size);
+
+enum class PhaseKind { Line, Size, Associativity };
+
+// One point of a phase: the chain that `generate` builds from these
+struct Point {
+  int stride;
+  uint64_t size;
+};
+
+// The sweep of one detection phase. The library measures it within a
+// budget and main's geometry mode until every point converges; both hand
+// the results to find_knee().
+struct Phase {
+  PhaseKind kind;
+  std::vector<Point> points;
+  ChainGenerator generate;
+};
+
+Phase get_line_phase();
+Phase get_size_phase(int cache_line_size,
+                     uint64_t min_size = CACHEGEOM_MIN_CACHESIZE);
+Phase get_associativity_phase(int cache_line_size);
+
+struct Detection {
+  // 0 if the phase found nothing
+  double value;
+  // The values the knee could also be at if every point were off by two
+  // standard errors, the way that moves the knee most
+  double low;
+  double high;
+  // How far the slowest point is above the fastest, over the ratio a knee
+  // needs: 1 is a borderline detection, higher is more certain
+  double confidence;
+};
+
+// What the points of `phase` show. `latencies` can be in any unit that is
+// proportional to the time per access, NaN for points that failed, and
+// `errors` are their standard errors in the same unit.
+Detection find_knee(Phase const &phase, std::vector<double> const &latencies,
+                    std::vector<double> const &errors);
+
+// TSC ticks per ns, counted against steady_clock for `duration`
+double calibrate_tsc(std::chrono::nanoseconds duration);
+
+// Chases `n_accesses` nodes of the chain that starts at `arr` and returns
+// the time it took in ns, read from the TSC
+double time_chase(volatile uint8_t *arr, uint64_t n_accesses,
+                  double tsc_per_ns);
+
+// Standard error of the mean of `samples`, 0 for fewer than two
+double get_standard_error(std::vector<double> const &samples);
+
+// Appends samples of `run` to `samples` until `deadline`, at least two so
+// that they have a standard error, and returns their mean
+double sample_until_deadline(std::function<double()> const &run,
+                             Clock::time_point deadline,
+                             std::vector<double> &samples);
+
+// Measures `phase` over a buffer of at least CACHEGEOM_ARENA_SIZE bytes,
+// giving its points equal shares of the time until `deadline`. Finds
+// nothing if it runs out of time first.
+Detection run_phase(volatile uint8_t *arr, Phase const &phase,
+                    double tsc_per_ns, Clock::time_point deadline);
+
+// Never fails: missing measurements fall back to the OS values
+CacheGeometry detect(std::chrono::milliseconds budget =
+                         std::chrono::milliseconds(100));
+
+} // namespace cachegeom
+
+#endif
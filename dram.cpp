@@ -0,0 +1,15 @@
+#include "dram.h"
+
+#include <emmintrin.h>
+
+uint64_t dram_pair_access(uint8_t *a, uint8_t *b, uint64_t n_iterations) {
+  uint64_t acc = 0;
+  for (uint64_t i = 0; i < n_iterations; i++) {
+    acc += *(volatile uint64_t *)a;
+    acc += *(volatile uint64_t *)b;
+    _mm_clflush(a);
+    _mm_clflush(b);
+    _mm_mfence();
+  }
+  return acc;
+}
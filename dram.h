@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+// Loads `a` and `b`, flushes both lines and fences, `n_iterations` times.
+// Every access goes to DRAM, and when `a` and `b` share a bank but not a
+// row the two accesses conflict in the row buffer.
+uint64_t dram_pair_access(uint8_t *a, uint8_t *b, uint64_t n_iterations);
@@ -0,0 +1,113 @@
+#include "evict.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <x86intrin.h>
+
+#define PROBE_ROUNDS 31
+#define TRAVERSALS 4
+
+// How much slower than a kept line the reload of an evicted one has to be
+#define EVICTION_RATIO 1.25
+
+// A noisy probe can drop a needed group, in which case the reduction starts
+// over from the full set
+#define MAX_REDUCTIONS 3
+
+uint64_t time_load(uint8_t *line) {
+  unsigned int aux;
+  _mm_mfence();
+  _mm_lfence();
+  uint64_t start = __rdtsc();
+  _mm_lfence();
+  *(volatile uint64_t *)line;
+  uint64_t end = __rdtscp(&aux);
+  _mm_lfence();
+  return end - start;
+}
+
+uint8_t *link_lines(std::vector<uint8_t *> const &lines) {
+  for (size_t i = 0; i < lines.size(); i++) {
+    *(uint8_t **)lines[i] = lines[(i + 1) % lines.size()];
+  }
+  return lines.empty() ? nullptr : lines[0];
+}
+
+uint64_t probe_after_chase(uint8_t *target, uint8_t *chain,
+                           uint64_t n_accesses) {
+  std::vector<uint64_t> ticks;
+  for (int round = 0; round < PROBE_ROUNDS; round++) {
+    time_load(target);
+    scalar_chase(chain, n_accesses);
+    ticks.push_back(time_load(target));
+  }
+  std::nth_element(ticks.begin(), ticks.begin() + ticks.size() / 2,
+                   ticks.end());
+  return ticks[ticks.size() / 2];
+}
+
+uint64_t probe_after_lines(uint8_t *target,
+                           std::vector<uint8_t *> const &lines) {
+  return probe_after_chase(target, link_lines(lines),
+                           lines.size() * TRAVERSALS);
+}
+
+// Group testing: out of any `ways + 1` groups of an eviction set larger than
+// `ways`, at least one holds no line that the set needs, so dropping the
+// first group that the rest still evicts without shrinks the set by a
+// fraction of 1 / (ways + 1) at every step. That takes O(ways^2 log n)
+// probes rather than the O(n) of dropping one line at a time.
+static std::vector<uint8_t *> reduce(std::vector<uint8_t *> lines,
+                                     uint8_t *target, uint64_t threshold,
+                                     int ways) {
+  while (lines.size() > (size_t)ways) {
+    size_t n_groups = std::min((size_t)ways + 1, lines.size());
+    bool reduced = false;
+    for (size_t group = 0; group < n_groups && !reduced; group++) {
+      size_t begin = group * lines.size() / n_groups;
+      size_t end = (group + 1) * lines.size() / n_groups;
+      std::vector<uint8_t *> without(lines.begin(), lines.begin() + begin);
+      without.insert(without.end(), lines.begin() + end, lines.end());
+      if (probe_after_lines(target, without) > threshold) {
+        lines = std::move(without);
+        reduced = true;
+      }
+    }
+    if (!reduced) {
+      break;
+    }
+  }
+  return lines;
+}
+
+EvictionSet find_eviction_set(std::vector<uint8_t *> const &pool,
+                              uint8_t *target, uint8_t *reference,
+                              uint64_t upper_ticks, int ways) {
+  // The prefix of the pool doubles until it evicts
+  EvictionSet set;
+  size_t size = 1;
+  do {
+    size = std::min(2 * size, pool.size());
+    set.lines.assign(pool.begin(), pool.begin() + size);
+    set.kept_ticks =
+        std::max(probe_after_lines(reference, set.lines), upper_ticks);
+    set.evicted_ticks = probe_after_lines(target, set.lines);
+  } while (set.evicted_ticks < EVICTION_RATIO * set.kept_ticks &&
+           size < pool.size());
+  if (set.evicted_ticks < EVICTION_RATIO * set.kept_ticks) {
+    return {};
+  }
+  set.threshold = (set.kept_ticks + set.evicted_ticks) / 2;
+
+  for (int attempt = 0; attempt < MAX_REDUCTIONS; attempt++) {
+    auto lines = reduce(set.lines, target, set.threshold, ways);
+    if (lines.size() <= (size_t)ways &&
+        probe_after_lines(target, lines) > set.threshold) {
+      set.lines = std::move(lines);
+      return set;
+    }
+  }
+  // The unreduced prefix evicts as well, but probing with thousands of
+  // lines tells nothing about single address bits
+  return {};
+}
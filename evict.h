@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// TSC ticks taken by a single load from `line`, fenced on both sides so
+// that nothing else overlaps with it
+uint64_t time_load(uint8_t *line);
+
+// Links `lines` into a cycle in the given order and returns its head
+uint8_t *link_lines(std::vector<uint8_t *> const &lines);
+
+// Median TSC ticks of reloading `target` right after it was loaded and then
+// `n_accesses` nodes of the chain at `chain` were chased
+uint64_t probe_after_chase(uint8_t *target, uint8_t *chain,
+                           uint64_t n_accesses);
+
+// Median TSC ticks of reloading `target` after every line in `lines` was
+// loaded a few times, which relinks them
+uint64_t probe_after_lines(uint8_t *target,
+                           std::vector<uint8_t *> const &lines);
+
+struct EvictionSet {
+  std::vector<uint8_t *> lines;
+  // Reloads of the target after `lines` and after lines that do not evict it
+  uint64_t evicted_ticks;
+  uint64_t kept_ticks;
+  // Reloads slower than this many TSC ticks were evictions
+  uint64_t threshold;
+};
+
+// Minimal set of lines from `pool` that evicts `target` from a cache with
+// `ways` ways. `reference` is a line in another set of every level, and
+// `upper_ticks` the reload from this level once the levels above lost the
+// line, 0 for L1; an eviction has to be clearly slower than both. No lines
+// if even the whole pool does not evict or the set could not be reduced to
+// `ways` lines. Every line of `pool` is written.
+EvictionSet find_eviction_set(std::vector<uint8_t *> const &pool,
+                              uint8_t *target, uint8_t *reference,
+                              uint64_t upper_ticks, int ways);
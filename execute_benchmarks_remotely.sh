@@ -17,7 +17,7 @@ fi
 
 # Step 1: Copy source files to the remote machine
 echo "Copying benchmark source files to $REMOTE_HOST:$REMOTE_DIR..."
-scp -r {main.cpp,Makefile} "$REMOTE_HOST:$REMOTE_DIR"
+scp -r {*.cpp,*.h,Makefile} "$REMOTE_HOST:$REMOTE_DIR"
 if [ $? -ne 0 ]; then
     echo "Error: Failed to copy files to remote host."
     exit 1
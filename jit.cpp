@@ -0,0 +1,73 @@
+#include "jit.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sys/mman.h>
+#include <vector>
+
+#define JIT_RANDOM_SEED 42
+
+// jmp rel32
+#define JMP_SIZE 5
+// dec rdi; jnz rel32; ret
+#define LOOP_TAIL_SIZE 10
+#define INT3 0xCC
+
+uint8_t *allocate_code(uint64_t length) {
+  void *code = mmap(nullptr, length, PROT_READ | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED) {
+    std::cerr << "Failed to map " << length << " bytes for code" << std::endl;
+    std::exit(1);
+  }
+  return (uint8_t *)code;
+}
+
+static void write_rel32(uint8_t *at, uint8_t *next_instruction,
+                        uint8_t *target) {
+  int32_t offset = (int32_t)(target - next_instruction);
+  std::memcpy(at, &offset, sizeof(offset));
+}
+
+CodeChain generate_code_chain(uint8_t *code, uint64_t length, int stride,
+                              uint64_t n_blocks, bool randomize) {
+  if (stride < LOOP_TAIL_SIZE || n_blocks * stride > length) {
+    std::cerr << "Cannot fit " << n_blocks << " blocks of " << stride
+              << " bytes into " << length << " bytes of code" << std::endl;
+    std::exit(1);
+  }
+  std::vector<uint64_t> order(n_blocks);
+  std::iota(order.begin(), order.end(), 0);
+  if (randomize) {
+    std::mt19937_64 generator(JIT_RANDOM_SEED);
+    std::shuffle(order.begin() + 1, order.end(), generator);
+  }
+
+  uint64_t footprint = n_blocks * stride;
+  mprotect(code, footprint, PROT_READ | PROT_WRITE);
+  std::memset(code, INT3, footprint);
+  for (uint64_t i = 0; i + 1 < n_blocks; i++) {
+    uint8_t *block = code + order[i] * stride;
+    uint8_t *next = code + order[i + 1] * stride;
+    block[0] = 0xE9;
+    write_rel32(block + 1, block + JMP_SIZE, next);
+  }
+  uint8_t *tail = code + order[n_blocks - 1] * stride;
+  // dec rdi
+  tail[0] = 0x48;
+  tail[1] = 0xFF;
+  tail[2] = 0xCF;
+  // jnz to the first block
+  tail[3] = 0x0F;
+  tail[4] = 0x85;
+  write_rel32(tail + 5, tail + 9, code);
+  // ret
+  tail[9] = 0xC3;
+  mprotect(code, footprint, PROT_READ | PROT_EXEC);
+  __builtin___clear_cache((char *)code, (char *)code + footprint);
+  return (CodeChain)code;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// Generated code runs `n_loops` times through its chain of blocks
+typedef void (*CodeChain)(uint64_t n_loops);
+
+// Maps `length` bytes for generated code. They stay read-execute except
+// while generate_code_chain writes them.
+uint8_t *allocate_code(uint64_t length);
+
+// Writes `n_blocks` blocks `stride` bytes apart at the start of `code`, each
+// a single jump to the next one, the last one looping back to the first.
+// With `randomize` the blocks are visited in a fixed random order, but the
+// chain is always entered at the first block. x86-64 only.
+CodeChain generate_code_chain(uint8_t *code, uint64_t length, int stride,
+                              uint64_t n_blocks, bool randomize);
@@ -1,45 +1,200 @@
 #include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <bit>
 #include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <iomanip>
 #include <limits>
+#include <linux/mempolicy.h>
+#include <map>
+#include <mutex>
 #include <numeric>
 #include <ostream>
 #include <random>
+#include <sched.h>
+#include <set>
 #include <stdlib.h>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <thread>
 #include <unistd.h>
 #include <utility>
 #include <vector>
+#include <x86intrin.h>
+
+#include "bandwidth.h"
+#include "binlog.h"
+#include "cachegeom.h"
+#include "dram.h"
+#include "evict.h"
+#include "jit.h"
+#include "ports.h"
+#include "report.h"
+#include "simd.h"
+#include "store.h"
+#include "tune.h"
 
 // --- General definitions
 #define KILOBYTE 1024
 #define MEGABYTE 1024 * KILOBYTE
 #define GIGABYTE 1024 * MEGABYTE
 
-// --- Search bounds
+// --- Search bounds, the ones libcachegeom uses as well
 // Cache line size
-#define MIN_CACHELINE_SIZE 16
-#define MAX_CACHELINE_SIZE 128
+#define MIN_CACHELINE_SIZE CACHEGEOM_MIN_CACHELINE_SIZE
+#define MAX_CACHELINE_SIZE CACHEGEOM_MAX_CACHELINE_SIZE
 // Cache size
-#define MIN_CACHESIZE 32 * KILOBYTE
-#define MAX_CACHESIZE 70 * KILOBYTE
-#define CACHESIZE_STEP 2 * KILOBYTE
+#define MIN_CACHESIZE CACHEGEOM_MIN_CACHESIZE
+#define MAX_CACHESIZE CACHEGEOM_MAX_CACHESIZE
+#define CACHESIZE_STEP CACHEGEOM_CACHESIZE_STEP
 // Number of sets
 #define MIN_N_SETS 8
-#define MAX_N_SETS 128
+#define MAX_N_SETS CACHEGEOM_MAX_N_SETS
+// Associativity
+#define DEFAULT_ASSOCIATIVITY CACHEGEOM_DEFAULT_ASSOCIATIVITY
+
+// TLB
+#define HUGE_PAGE_SIZE (2 * MEGABYTE)
+#define TLB_ARENA_LENGTH ((uint64_t)1 * GIGABYTE)
+#define TLB_HUGE_ARENA_LENGTH ((uint64_t)4 * GIGABYTE)
+#define TLB_MIN_PAGES 4
+#define TLB_MAX_PAGES 4096
+#define TLB_MAX_WAYS 24
+
+// Bandwidth
+#define BANDWIDTH_ACCESS_SIZE 16
+#define BANDWIDTH_BYTES_PER_RUN ((uint64_t)1 * GIGABYTE)
+#define BANDWIDTH_DRAM_SIZE ((uint64_t)1 * GIGABYTE)
+#define DEFAULT_L1_SIZE (32 * KILOBYTE)
+#define DEFAULT_L2_SIZE (1 * MEGABYTE)
+#define DEFAULT_L3_SIZE (32 * MEGABYTE)
+
+// SIMD
+#define SIMD_NODE_STRIDE 64
+
+// Split and aliasing
+#define DEFAULT_CACHELINE_SIZE CACHEGEOM_DEFAULT_CACHELINE_SIZE
+#define SPLIT_ARR_SIZE (16 * KILOBYTE)
+#define SPLIT_ACCESS_SIZE 8
+#define PAGE_SPLIT_N_NODES 4
+
+// Load ports
+#define PORTS_ACCESS_SIZE 8
+
+// Stores
+#define STORE_BUFFER_CHAIN_SIZE ((uint64_t)256 * MEGABYTE)
+#define STORE_BUFFER_MAX_STORES 192
+#define STORE_BUFFER_STEP 8
+#define STORE_BUFFER_ITERATIONS 1000000
+#define WRITE_POLICY_ROUNDS 10000
+#define WRITE_POLICY_EVICT_FACTOR 4
+
+// Inclusion
+#define INCLUSION_SWEEP_WIDTH 2
+#define INCLUSION_STEPS_PER_LOWER 2
+#define INCLUSION_HOT_FRACTION 4
+#define INCLUSION_STREAM_FACTOR 2
+#define INCLUSION_STREAM_LINES 64
+#define INCLUSION_STREAM_PASSES 2
+
+// Instruction cache
+#define JIT_ARENA_LENGTH ((uint64_t)64 * MEGABYTE)
+#define ICACHE_LINE_FOOTPRINT (1 * MEGABYTE)
+#define MIN_ICACHE_SIZE (8 * KILOBYTE)
+#define MAX_ICACHE_SIZE (128 * KILOBYTE)
+#define ICACHE_SIZE_STEP (4 * KILOBYTE)
+#define ICACHE_MAX_WAYS 16
+
+// NUMA
+#define NUMA_ARR_LENGTH ((uint64_t)1 * GIGABYTE)
+#define NUMA_MAX_NODES 1024
+#define NODES_SYSFS_DIR "/sys/devices/system/node"
+#define CPUS_SYSFS_DIR "/sys/devices/system/cpu"
+
+// DRAM
+#define DRAM_MIN_BIT 6
+#define DRAM_PAIR_ITERATIONS 1000000
+#define LOADED_CHASE_LENGTH ((uint64_t)256 * MEGABYTE)
+#define LOADED_N_ACCESSES 10000000
+#define BACKGROUND_CHUNK_SIZE (64 * KILOBYTE)
+
+// Loaded latency
+#define LOADED_N_RATES 8
+
+// SMT interference
+#define SMT_MIN_CACHESIZE (8 * KILOBYTE)
+#define SMT_COMPUTE_CHUNK 1000000
+
+// Conflict misses
+#define CONFLICT_MAX_STRIDE (16 * KILOBYTE)
+// Fewer huge pages than the second-level TLB holds on any core we know of
+#define CONFLICT_MAX_HUGE_PAGES 1024
+#define CONFLICT_N_ACCESSES 4000000
+
+// Set index
+#define SETS_ARENA_LENGTH ((uint64_t)1 * GIGABYTE)
+#define SETS_MAX_POOL 4096
+#define DEFAULT_SETS_WAYS 16
+
+// Autotune
+#define TUNE_TRANSPOSE_N 2048
+#define TUNE_GEMM_N 512
+#define TUNE_RADIX_N (4 * 1024 * 1024)
+#define TUNE_RADIX_KEY_BITS 16
+#define TUNE_MIN_BLOCK 4
+#define TUNE_SEARCH_FACTOR 8
+
+// Build
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
+
+// Probe
+#define PROBE_DEFAULT_BUDGET_MS 100
+
+// Results database
+#define REPORT_PATH "report.html"
+#define RESULTS_DB_PATH "results.db"
+#define CPUFREQ_SYSFS_DIR "/sys/devices/system/cpu/cpu0/cpufreq"
 
 // Statistical thresholds
-#define CACHESIZE_JUMP_THRESHOLD 1e7
 #define N_SETS_JUMP_THRESHOLD (2 * 1e8)
 #define N_SETS_STABILIZATION_EPSILON (1e8)
+#define TLB_JUMP_RATIO 1.15
+#define BANK_CONFLICT_RATIO 0.8
+#define ICACHE_JUMP_RATIO 1.15
+#define ICACHE_KNEE_FRACTION 0.5
+#define STORE_BUFFER_STALL_RATIO 1.5
+#define WRITE_ALLOCATE_FRACTION 0.5
+#define WRITE_BACK_RATIO 1.05
+#define INCLUSION_KNEE_FRACTION 0.5
+#define INCLUSION_MIN_GAP_RATIO 1.2
+#define ROW_CONFLICT_FRACTION 0.5
+#define BACK_INVALIDATION_RATIO 1.5
+#define CONFLICT_SLOWDOWN_RATIO 1.5
 
 // Benchmark parameters
 #define ARR_LENGTH (uint64_t)4 * GIGABYTE
 #define N_ACCESSES 500000000
 
+#define RANDOM_CHAIN_SEED CACHEGEOM_RANDOM_CHAIN_SEED
+
+// Cycle timer
+#define TSC_CALIBRATION_NS 2000000
+
 // Precision parameters
 #define PRECISION 1
 #define REQUIRED_N_CONVERGED_RUNS 5
@@ -54,15 +209,47 @@ struct BenchmarkResult {
   BenchmarkParameters parameters;
   double result;
   double increase;
+  // Standard error of `result`, 0 where it is not known
+  double error = 0;
 };
 
-int find_first_performance_spike(std::vector<BenchmarkResult> const &results) {
-  // Compute mean increase
+// Failed points carry NaN: every comparison with it is false, so analyses
+// skip them instead of the whole run being lost
+bool is_failed(double result) { return std::isnan(result); }
+
+// NaN if no increase was measured
+double get_mean_increase(std::vector<BenchmarkResult> const &results) {
   double sum = 0;
+  int n_measured = 0;
   for (auto it = results.begin() + 1; it != results.end(); ++it) {
-    sum += it->increase;
+    if (!is_failed(it->increase)) {
+      sum += it->increase;
+      n_measured++;
+    }
   }
-  double mean_increase = sum / (results.size() - 1);
+  if (n_measured == 0) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  return sum / n_measured;
+}
+
+// Tells a phase that found nothing because its points diverged from one
+// whose points showed nothing
+void report_not_detected(std::string const &what,
+                         std::vector<BenchmarkResult> const &results) {
+  size_t n_failed =
+      std::count_if(results.begin(), results.end(),
+                    [](auto const &r) { return is_failed(r.result); });
+  if (results.size() - n_failed < 2) {
+    std::cerr << "Could not detect " << what << ": " << n_failed << " of "
+              << results.size() << " points diverged!" << std::endl;
+  } else {
+    std::cerr << "Could not detect " << what << "!" << std::endl;
+  }
+}
+
+int find_first_performance_spike(std::vector<BenchmarkResult> const &results) {
+  double mean_increase = get_mean_increase(results);
 
   // Find first stride for which increase is greater than mean
   for (auto it = results.begin() + 1; it != results.end(); ++it) {
@@ -73,34 +260,106 @@ int find_first_performance_spike(std::vector<BenchmarkResult> const &results) {
   return -1;
 }
 
-volatile uint8_t *allocate_array() {
+volatile uint8_t *allocate_array(uint64_t length = ARR_LENGTH,
+                                 std::ostream &log = std::cerr) {
   long page_size = sysconf(_SC_PAGE_SIZE);
-  void *arr = aligned_alloc(page_size, ARR_LENGTH);
-  std::cerr << "Allocated array of " << ARR_LENGTH << " bytes" << std::endl;
+  void *arr = aligned_alloc(page_size, length);
+  log << "Allocated array of " << length << " bytes" << std::endl;
   if (arr == nullptr) {
-    std::cerr << "Failed to allocate array of length " << ARR_LENGTH
+    std::cerr << "Failed to allocate array of length " << length
               << std::endl;
     std::exit(1);
   }
-  std::fill_n((volatile uint8_t *)arr, ARR_LENGTH, (uint8_t)0);
+  // Touches every page; a volatile loop would crawl at -O0
+  std::memset(arr, 0, length);
   return (uint8_t *)arr;
 }
 
-int generate_chain(volatile uint8_t *arr, int stride, uint64_t arr_size) {
-  volatile uint64_t *ptr_arr = (volatile uint64_t *)arr;
-  auto ptr_arr_size = arr_size / sizeof(uint64_t);
-  stride = stride / sizeof(uint64_t);
+// Bytes of `arr` that THP backs with huge pages, summed over the mappings
+// of /proc/self/smaps that overlap it
+uint64_t get_huge_page_bytes(volatile uint8_t *arr, uint64_t length) {
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool overlaps = false;
+  uint64_t bytes = 0;
+  while (std::getline(smaps, line)) {
+    size_t dash = line.find('-');
+    size_t space = line.find(' ');
+    // Mapping headers start with "start-end ", fields with "Name:"
+    if (dash != std::string::npos && dash < space &&
+        line.find(':') > space) {
+      uint64_t start = std::stoull(line.substr(0, dash), nullptr, 16);
+      uint64_t end =
+          std::stoull(line.substr(dash + 1, space - dash - 1), nullptr, 16);
+      overlaps = start < (uint64_t)arr + length && (uint64_t)arr < end;
+    } else if (overlaps && line.starts_with("AnonHugePages:")) {
+      bytes += std::stoull(line.substr(line.find_first_of("0123456789"))) *
+               KILOBYTE;
+    }
+  }
+  return bytes;
+}
 
-  uint64_t prev_index = 0;
-  for (uint64_t index = stride; index < ptr_arr_size; index += stride) {
-    ptr_arr[prev_index] = (uint64_t)&ptr_arr[index];
-    prev_index = index;
+// Maps a separate buffer for the page-granular phases. Small pages are
+// explicitly excluded from THP so that every chain node really lives on its
+// own 4 KiB page; huge pages are taken from hugetlbfs if the host reserved
+// any, and from THP otherwise.
+volatile uint8_t *allocate_pages(uint64_t length, bool huge_pages) {
+  int prot = PROT_READ | PROT_WRITE;
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  if (huge_pages) {
+    void *arr = mmap(nullptr, length, prot, flags | MAP_HUGETLB, -1, 0);
+    if (arr != MAP_FAILED) {
+      std::cerr << "Allocated " << length << " bytes of hugetlbfs pages"
+                << std::endl;
+      std::fill_n((volatile uint8_t *)arr, length, (uint8_t)0);
+      return (uint8_t *)arr;
+    }
+    std::cerr << "No hugetlbfs pages reserved, falling back to THP"
+              << std::endl;
+  }
+  // Over-allocate so that the buffer can be aligned to a huge page boundary
+  void *mapping = mmap(nullptr, length + HUGE_PAGE_SIZE, prot, flags, -1, 0);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Failed to map " << length << " bytes" << std::endl;
+    std::exit(1);
+  }
+  uint64_t aligned = ((uint64_t)mapping + HUGE_PAGE_SIZE - 1) &
+                     ~(uint64_t)(HUGE_PAGE_SIZE - 1);
+  void *arr = (void *)aligned;
+  // Unmap the slack so that free_pages only has to know the buffer
+  uint64_t head = aligned - (uint64_t)mapping;
+  if (head > 0) {
+    munmap(mapping, head);
   }
-  ptr_arr[prev_index] = (uint64_t)&ptr_arr[0];
-  return ptr_arr_size / stride;
+  munmap((uint8_t *)arr + length, HUGE_PAGE_SIZE - head);
+  madvise(arr, length, huge_pages ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+  std::fill_n((volatile uint8_t *)arr, length, (uint8_t)0);
+  std::cerr << "Allocated " << length << " bytes of "
+            << (huge_pages ? "transparent huge" : "small") << " pages"
+            << std::endl;
+  // THP is best effort, and what the callers find depends on getting it
+  if (huge_pages) {
+    uint64_t huge_bytes = get_huge_page_bytes((uint8_t *)arr, length);
+    if (huge_bytes < length) {
+      std::cerr << "Warning: only " << huge_bytes << " of " << length
+                << " bytes are backed by huge pages, small-page TLB misses "
+                   "will show up in the results"
+                << std::endl;
+    }
+  }
+  return (uint8_t *)arr;
+}
+
+void free_pages(volatile uint8_t *arr, uint64_t length) {
+  munmap((void *)arr, length);
 }
 
-long long benchmark(volatile uint8_t *arr) {
+// Chains are built the way libcachegeom builds them
+using cachegeom::generate_chain;
+using cachegeom::generate_random_chain;
+
+long long benchmark(volatile uint8_t *arr, std::ostream &log = std::cerr) {
   auto value = (volatile uint64_t *)arr;
   auto start = std::chrono::steady_clock::now();
   // >>> begin benchmark
@@ -111,28 +370,280 @@ long long benchmark(volatile uint8_t *arr) {
   auto end = std::chrono::steady_clock::now();
   auto elapsed_ns =
       std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
-  std::cerr << "benchmark acc=" << (uint64_t)value << std::endl;
+  log << "benchmark acc=" << (uint64_t)value << std::endl;
   return elapsed_ns;
 }
 
-double run_benchmark_until_converges(volatile uint8_t *arr) {
+// One JSON object per line. Keys keep the order they were added in.
+struct JsonObject {
+  std::string fields;
+};
+
+std::string to_json(std::string const &value) {
+  std::ostringstream json;
+  json << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      json << '\\' << c;
+    } else if ((uint8_t)c < 0x20) {
+      json << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+           << (int)c << std::dec;
+    } else {
+      json << c;
+    }
+  }
+  json << '"';
+  return json.str();
+}
+
+// JSON has no NaN, failed points become null
+std::string to_json(double value) {
+  if (!std::isfinite(value)) {
+    return "null";
+  }
+  std::ostringstream json;
+  json << std::setprecision(std::numeric_limits<double>::max_digits10)
+       << value;
+  return json.str();
+}
+
+std::string to_json(std::vector<double> const &values) {
+  std::string json = "[";
+  for (size_t i = 0; i < values.size(); i++) {
+    json += (i == 0 ? "" : ",") + to_json(values[i]);
+  }
+  return json + "]";
+}
+
+void add_raw(JsonObject &object, std::string const &key,
+             std::string const &json) {
+  object.fields += (object.fields.empty() ? "" : ",") + to_json(key) + ":" +
+                   json;
+}
+
+void add(JsonObject &object, std::string const &key,
+         std::string const &value) {
+  add_raw(object, key, to_json(value));
+}
+
+void add(JsonObject &object, std::string const &key, double value) {
+  add_raw(object, key, to_json(value));
+}
+
+// Structured output goes to its own file next to the CSV on stdout and is
+// flushed line by line so that it can be tailed while the run goes on
+std::ofstream ndjson;
+
+void emit(JsonObject const &object) {
+  if (ndjson.is_open()) {
+    ndjson << "{" << object.fields << "}" << std::endl;
+  }
+}
+
+// Reports a value and the range and confidence of the knee it came from,
+// see cachegeom::Detection. Cached values and those taken from the OS come
+// without either.
+void emit_detection(std::string const &name,
+                    cachegeom::Detection const &detected,
+                    bool cached = false, bool measured = true) {
+  JsonObject detection;
+  add(detection, "type", "detection");
+  add(detection, "name", name);
+  add(detection, "value", detected.value);
+  add(detection, "low", cached ? NAN : detected.low);
+  add(detection, "high", cached ? NAN : detected.high);
+  add(detection, "confidence", cached ? NAN : detected.confidence);
+  add_raw(detection, "cached", cached ? "true" : "false");
+  add_raw(detection, "measured", measured ? "true" : "false");
+  emit(detection);
+}
+
+// Every converged result is appended to the checkpoint file as soon as it
+// is known, tagged with the point it belongs to. Almost all decisions a mode
+// makes depend only on the results it has seen, so a resumed run replays the
+// recorded results in order and reaches exactly the point where the
+// interrupted one stopped, in the middle of a phase included. Whatever else
+// changes the path, e.g. a phase that results.db now holds, shows up as a
+// tag that does not match, and the run measures from there on.
+struct Checkpoint {
+  std::string path;
+  std::string mode;
+  std::ofstream file;
+  std::vector<std::pair<std::string, double>> recorded;
+  size_t n_replayed = 0;
+};
+
+Checkpoint checkpoint;
+
+// The tag of a point: its benchmark and the two parameters that tell the
+// points of a benchmark apart, stride and array size for most
+std::string point_tag(std::string const &benchmark, double first,
+                      double second) {
+  std::ostringstream tag;
+  tag << std::setprecision(std::numeric_limits<double>::max_digits10)
+      << benchmark << "," << first << "," << second;
+  return tag.str();
+}
+
+// Starts a checkpoint file that holds the results replayed so far
+void rewrite_checkpoint() {
+  checkpoint.file.close();
+  checkpoint.file.open(checkpoint.path, std::ios::trunc);
+  checkpoint.file << std::setprecision(
+      std::numeric_limits<double>::max_digits10);
+  checkpoint.file << "mode," << checkpoint.mode << std::endl;
+  for (size_t i = 0; i < checkpoint.n_replayed; i++) {
+    auto const &[point, result] = checkpoint.recorded[i];
+    checkpoint.file << point << "," << result << std::endl;
+  }
+}
+
+// Starts recording to `path`. With `resume` the results recorded there by an
+// earlier run of the same mode are replayed first. A checkpoint that does
+// not exist yet resumes nothing, so that a wrapper can pass --resume to the
+// first attempt as well.
+void open_checkpoint(std::string const &path, std::string const &mode,
+                     bool resume) {
+  if (resume && !std::filesystem::exists(path)) {
+    std::cerr << "No checkpoint at " << path << " yet, starting fresh"
+              << std::endl;
+    resume = false;
+  }
+  if (resume) {
+    std::ifstream file(path);
+    if (!file) {
+      std::cerr << "Failed to read checkpoint " << path << std::endl;
+      std::exit(1);
+    }
+    std::string line;
+    std::getline(file, line);
+    if (line != "mode," + mode) {
+      std::cerr << "No checkpoint of mode " << mode << " in " << path
+                << std::endl;
+      std::exit(1);
+    }
+    while (std::getline(file, line)) {
+      size_t comma = line.rfind(',');
+      if (comma == std::string::npos) {
+        continue;
+      }
+      try {
+        checkpoint.recorded.push_back(
+            {line.substr(0, comma), std::stod(line.substr(comma + 1))});
+      } catch (std::exception const &) {
+      }
+    }
+    std::cerr << "Resuming after " << checkpoint.recorded.size()
+              << " recorded results" << std::endl;
+    checkpoint.file.open(path, std::ios::app);
+  } else {
+    checkpoint.file.open(path, std::ios::trunc);
+    checkpoint.file << "mode," << mode << std::endl;
+  }
+  if (!checkpoint.file) {
+    std::cerr << "Failed to open checkpoint " << path << std::endl;
+    std::exit(1);
+  }
+  checkpoint.file << std::setprecision(
+      std::numeric_limits<double>::max_digits10);
+  checkpoint.path = path;
+  checkpoint.mode = mode;
+}
+
+// Whether the result `offset` points ahead in the checkpoint is the one of
+// `point`, so that measuring `point` there will replay it
+bool will_replay(size_t offset, std::string const &point) {
+  size_t index = checkpoint.n_replayed + offset;
+  return index < checkpoint.recorded.size() &&
+         checkpoint.recorded[index].first == point;
+}
+
+// Once the run measures something, the results it did not replay belong to
+// another path and are dropped from the checkpoint
+void discard_unreplayed() {
+  if (checkpoint.n_replayed == checkpoint.recorded.size()) {
+    return;
+  }
+  std::cerr << "The checkpoint diverges from this run after "
+            << checkpoint.n_replayed << " results, dropping the other "
+            << checkpoint.recorded.size() - checkpoint.n_replayed
+            << std::endl;
+  checkpoint.recorded.resize(checkpoint.n_replayed);
+  rewrite_checkpoint();
+}
+
+void record_result(std::string const &point, double result) {
+  if (checkpoint.file.is_open()) {
+    discard_unreplayed();
+    checkpoint.file << point << "," << result << std::endl;
+  }
+}
+
+// How a point turns samples into its result. Converge keeps sampling until
+// the running mean settles and is what every mode uses by default. Budget
+// samples until the point's deadline and takes the mean, whatever the noise,
+// for geometry runs that must finish in a fixed time.
+enum class MeasurementPolicy { Converge, Budget };
+
+struct Measurement {
+  MeasurementPolicy policy = MeasurementPolicy::Converge;
+  // Budget only: when the current phase and point have to be done, and the
+  // TSC rate that times its samples
+  std::chrono::steady_clock::time_point phase_deadline;
+  std::chrono::steady_clock::time_point point_deadline;
+  double tsc_per_ns = 0;
+};
+
+Measurement measurement;
+
+const char *to_string(MeasurementPolicy policy) {
+  switch (policy) {
+  case MeasurementPolicy::Converge:
+    return "running_mean";
+  case MeasurementPolicy::Budget:
+    return "budget_mean";
+  }
+  return "unknown";
+}
+
+// Reports how a point was estimated: its tag, every raw sample in ns, the
+// estimator and its result, or NaN if it failed. The tag ties the samples to
+// their parameters wherever the row of the point ends up.
+void emit_point(std::string const &tag, std::vector<double> const &samples,
+                double result, std::string const &estimator) {
+  JsonObject point;
+  add(point, "type", "point");
+  add(point, "point", tag);
+  add(point, "estimator", estimator);
+  add(point, "result", result);
+  add(point, "uncertainty", cachegeom::get_standard_error(samples));
+  add_raw(point, "converged", is_failed(result) ? "false" : "true");
+  add(point, "n_samples", samples.size());
+  add_raw(point, "samples", to_json(samples));
+  emit(point);
+}
+
+double sample_until_converges(std::function<long long()> const &run,
+                              std::vector<double> &samples,
+                              std::ostream &log = std::cerr) {
   int n = 0;
   long long sum = 0;
   double mean = 0;
   int n_successes = 0;
   while (n < TOTAL_RUNS_THRESHOLD) {
-    auto bench_result = benchmark(arr);
+    auto bench_result = run();
+    samples.push_back(bench_result);
     n++;
     sum += bench_result;
     auto cur_mean = ((double)sum) / n;
     auto current_err = abs(cur_mean - mean) / mean * 100;
-    std::cerr << "Run " << n << ": Current benchmark results = " << cur_mean
-              << ", current error = " << current_err << "%" << std::endl;
+    log << "Run " << n << ": Current benchmark results = " << cur_mean
+        << ", current error = " << current_err << "%" << std::endl;
     if (current_err < PRECISION) {
       n_successes++;
       if (n_successes >= REQUIRED_N_CONVERGED_RUNS) {
-        std::cerr << "Converged to " << cur_mean << " on the " << n
-                  << "-th iteration" << std::endl;
+        log << "Converged to " << cur_mean << " on the " << n
+            << "-th iteration" << std::endl;
         return cur_mean;
       }
     } else {
@@ -140,30 +651,474 @@ double run_benchmark_until_converges(volatile uint8_t *arr) {
     }
     mean = cur_mean;
   }
-  std::cout << "Benchmark results diverge!" << std::endl;
-  std::exit(1);
+  log << "Benchmark results diverge!" << std::endl;
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+double sample_until_deadline(std::function<long long()> const &run,
+                             std::vector<double> &samples) {
+  double mean = cachegeom::sample_until_deadline(
+      [&run]() { return (double)run(); }, measurement.point_deadline,
+      samples);
+  std::cerr << "Mean of " << samples.size() << " runs is " << mean << " +- "
+            << cachegeom::get_standard_error(samples) << std::endl;
+  return mean;
+}
+
+// Checkpoints and reports a point that was measured under the current
+// policy
+void record_point(std::string const &point, std::vector<double> const &samples,
+                  double result) {
+  record_result(point, result);
+  emit_point(point, samples, result, to_string(measurement.policy));
+}
+
+// The next result of the checkpoint, which will_replay() vouched for
+double replay_next() {
+  auto const &point = checkpoint.recorded[checkpoint.n_replayed].first;
+  double result = checkpoint.recorded[checkpoint.n_replayed++].second;
+  std::cerr << "Replayed " << result << " from the checkpoint" << std::endl;
+  emit_point(point, {}, result, "checkpoint");
+  return result;
+}
+
+// Measures `point` under the current policy and sets `error` to the
+// standard error of the result, 0 for replayed points, whose samples are
+// gone
+double measure(std::string const &point, std::function<long long()> const &run,
+               double &error) {
+  error = 0;
+  if (will_replay(0, point)) {
+    return replay_next();
+  }
+  std::vector<double> samples;
+  double result = std::numeric_limits<double>::quiet_NaN();
+  switch (measurement.policy) {
+  case MeasurementPolicy::Converge:
+    result = sample_until_converges(run, samples);
+    break;
+  case MeasurementPolicy::Budget:
+    result = sample_until_deadline(run, samples);
+    break;
+  }
+  error = cachegeom::get_standard_error(samples);
+  record_point(point, samples, result);
+  return result;
+}
+
+double measure(std::string const &point,
+               std::function<long long()> const &run) {
+  double error;
+  return measure(point, run, error);
+}
+
+// Budget samples chase as many nodes as libcachegeom's, timed by the TSC,
+// which is cheap and precise enough for runs of a few microseconds. They
+// are scaled to N_ACCESSES so that they read like converged results.
+long long benchmark_quick(volatile uint8_t *arr) {
+  return cachegeom::time_chase(arr, CACHEGEOM_RUN_N_ACCESSES,
+                               measurement.tsc_per_ns) *
+         ((double)N_ACCESSES / CACHEGEOM_RUN_N_ACCESSES);
+}
+
+double measure_benchmark(std::string const &point, volatile uint8_t *arr,
+                         double &error) {
+  if (measurement.policy == MeasurementPolicy::Budget) {
+    return measure(
+        point, [arr]() { return benchmark_quick(arr); }, error);
+  }
+  return measure(point, [arr]() { return benchmark(arr); }, error);
+}
+
+double measure_benchmark(std::string const &point, volatile uint8_t *arr) {
+  double error;
+  return measure_benchmark(point, arr, error);
+}
+
+// TSC ticks per ns, against steady_clock
+double calibrate_tsc() {
+  return cachegeom::calibrate_tsc(std::chrono::nanoseconds(TSC_CALIBRATION_NS));
+}
+
+// With --log=<path> the rows go to a binary log instead of stdout, which
+// the convert mode turns back into this CSV. --trace=<path> records the
+// node offsets of every chain run_benchmarks() measures.
+Binlog results_log;
+Binlog trace_log;
+uint32_t n_traced_chains = 0;
+
+void close_logs() {
+  close_binlog(results_log);
+  close_binlog(trace_log);
+}
+
+// The unit of `result` depends on the benchmark: the rows HIGHER_IS_BETTER
+// lists carry GB/s, or loads per cycle for load_throughput; latency*,
+// numa_latency*, icache and smt* rows carry the total time of N_ACCESSES
+// accesses in ns; all other rows ns per operation. For bandwidth and
+// throughput `stride` is the bytes per access, for autotune rows the tuned
+// parameter, and smt rows carry the measured L1 capacity in `arr_size`.
+void print_csv_header() {
+  if (!is_open(results_log)) {
+    std::cout << "benchmark,threads,stride,arr_size,result,increase"
+              << std::endl;
+  }
+}
+
+void print_result(std::string const &benchmark_name, int n_threads,
+                  BenchmarkResult const &result) {
+  if (is_open(results_log)) {
+    auto record = (ResultRecord *)append_record(results_log);
+    if (benchmark_name.size() >= sizeof(record->benchmark)) {
+      std::cerr << "Warning: the binary log truncates " << benchmark_name
+                << " to " << sizeof(record->benchmark) - 1 << " characters"
+                << std::endl;
+    }
+    std::strncpy(record->benchmark, benchmark_name.c_str(),
+                 sizeof(record->benchmark) - 1);
+    record->benchmark[sizeof(record->benchmark) - 1] = '\0';
+    record->threads = n_threads;
+    record->stride = result.parameters.stride;
+    record->arr_size = result.parameters.arr_size;
+    record->result = result.result;
+    record->increase = result.increase;
+  } else {
+    std::cout << benchmark_name << "," << n_threads << ","
+              << result.parameters.stride << "," << result.parameters.arr_size
+              << "," << result.result << "," << result.increase << std::endl;
+  }
+
+  JsonObject row;
+  add(row, "type", "row");
+  add(row, "benchmark", benchmark_name);
+  add(row, "threads", n_threads);
+  add(row, "stride", result.parameters.stride);
+  add(row, "arr_size", result.parameters.arr_size);
+  add(row, "result", result.result);
+  add(row, "increase", result.increase);
+  add_raw(row, "higher_is_better",
+          is_higher_better(benchmark_name) ? "true" : "false");
+  emit(row);
+}
+
+std::string read_file(std::string const &path) {
+  std::ifstream file(path);
+  std::string content;
+  std::getline(file, content);
+  return content;
+}
+
+// Parses the kernel's list format, e.g. "0-3,8-11"
+std::vector<int> parse_list(std::string const &list) {
+  std::vector<int> items;
+  size_t position = 0;
+  while (position < list.size()) {
+    size_t end = list.find(',', position);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    std::string range = list.substr(position, end - position);
+    size_t dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last =
+        dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for (int item = first; item <= last; item++) {
+      items.push_back(item);
+    }
+    position = end + 1;
+  }
+  return items;
+}
+
+// Restricts the calling thread, and the threads it starts later, to `cpus`
+void pin_to_cpus(std::vector<int> const &cpus) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    std::cerr << "Failed to pin to " << cpus.size() << " CPUs" << std::endl;
+    std::exit(1);
+  }
+}
+
+// The affinity mask of the calling thread, for restore_affinity()
+cpu_set_t get_affinity() {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  sched_getaffinity(0, sizeof(cpu_set), &cpu_set);
+  return cpu_set;
+}
+
+// Undoes pin_to_cpus() once a phase no longer needs the thread pinned
+void restore_affinity(cpu_set_t const &cpu_set) {
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    std::cerr << "Failed to restore the CPU affinity" << std::endl;
+    std::exit(1);
+  }
+}
+
+typedef cachegeom::ChainGenerator ChainGenerator;
+
+// Appends the chain that starts at `arr` to the trace, if one is recorded
+void trace_chain(volatile uint8_t *arr) {
+  if (!is_open(trace_log)) {
+    return;
+  }
+  auto node = (volatile uint8_t *)arr;
+  uint32_t index = 0;
+  do {
+    auto record = (TraceRecord *)append_record(trace_log);
+    record->point = n_traced_chains;
+    record->index = index++;
+    record->offset = node - arr;
+    node = *(volatile uint8_t *volatile *)node;
+  } while (node != arr);
+  n_traced_chains++;
+}
+
+// Cores that run_benchmarks() may measure on at the same time, one CPU of
+// each. Points whose footprint fits into `private_cache_size` never touch
+// anything the cores share, so they do not disturb each other. No CPUs
+// unless --parallel was given.
+struct Scheduler {
+  std::vector<int> cpus;
+  uint64_t private_cache_size = 0;
+};
+
+Scheduler scheduler;
+
+// Sizes in sysfs look like "48K"
+uint64_t parse_size(std::string const &size) {
+  if (size.empty()) {
+    return 0;
+  }
+  uint64_t value = std::stoull(size);
+  switch (size.back()) {
+  case 'K':
+    return value * KILOBYTE;
+  case 'M':
+    return value * MEGABYTE;
+  }
+  return value;
+}
+
+// One data cache level as seen from a core
+struct CoreCache {
+  std::string level;
+  uint64_t size;
+  // Shared with no other core
+  bool is_private;
+
+  bool operator==(CoreCache const &) const = default;
+};
+
+// The data cache levels of `cpu`, whose SMT siblings are `siblings`
+std::vector<CoreCache> get_core_caches(int cpu,
+                                       std::vector<int> const &siblings) {
+  std::string cache_dir =
+      CPUS_SYSFS_DIR "/cpu" + std::to_string(cpu) + "/cache";
+  std::vector<CoreCache> caches;
+  for (int index = 0;; index++) {
+    std::string index_dir = cache_dir + "/index" + std::to_string(index);
+    std::string type = read_file(index_dir + "/type");
+    if (type.empty()) {
+      break;
+    }
+    if (type != "Instruction") {
+      caches.push_back(
+          {read_file(index_dir + "/level"),
+           parse_size(read_file(index_dir + "/size")),
+           parse_list(read_file(index_dir + "/shared_cpu_list")) ==
+               siblings});
+    }
+  }
+  return caches;
+}
+
+// The first allowed CPU of every physical core whose caches look like those
+// of the first one, so that no two workers are SMT siblings and hybrid parts
+// only get workers of one core type, and the largest data cache level that
+// these cores share with no other core
+Scheduler get_scheduler() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  Scheduler result;
+  std::vector<CoreCache> first_caches;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (!CPU_ISSET(cpu, &allowed)) {
+      continue;
+    }
+    std::string cpu_dir = CPUS_SYSFS_DIR "/cpu" + std::to_string(cpu);
+    auto siblings = parse_list(
+        read_file(cpu_dir + "/topology/thread_siblings_list"));
+    bool has_earlier_sibling =
+        std::any_of(siblings.begin(), siblings.end(), [&](int sibling) {
+          return sibling < cpu && CPU_ISSET(sibling, &allowed);
+        });
+    if (has_earlier_sibling) {
+      continue;
+    }
+    auto caches = get_core_caches(
+        cpu, siblings.empty() ? std::vector<int>{cpu} : siblings);
+    if (result.cpus.empty()) {
+      first_caches = caches;
+    } else if (caches != first_caches) {
+      std::cerr << "Skipping CPU " << cpu
+                << ": its caches differ from those of CPU "
+                << result.cpus[0] << std::endl;
+      continue;
+    }
+    result.cpus.push_back(cpu);
+  }
+  for (auto const &cache : first_caches) {
+    if (cache.is_private) {
+      result.private_cache_size =
+          std::max(result.private_cache_size, cache.size);
+    }
+  }
+  // Hosts that hide their cache topology get the L1 size, which is private
+  // on every core we know of
+  if (result.private_cache_size == 0) {
+    long l1_size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    result.private_cache_size = l1_size > 0 ? l1_size : DEFAULT_L1_SIZE;
+  }
+  return result;
+}
+
+// Bytes a chase of `params` may touch, in whole pages. Nodes lie within
+// `arr_size`, and a pair chain reaches up to one stride past it. Pages are
+// what the worker's arena has to back and what its TLB has to map, so a
+// sparse chase counts with the pages it spans rather than with its lines.
+uint64_t get_footprint(BenchmarkParameters const &params) {
+  uint64_t page_size = sysconf(_SC_PAGE_SIZE);
+  uint64_t span = params.arr_size + params.stride;
+  return (span + page_size - 1) / page_size * page_size;
+}
+
+// Measures the points of `parameters_sequence` that fit into the private
+// caches on the scheduler's cores, each worker pinned to its core and
+// chasing its own arena, and leaves the others NaN. Workers keep their log
+// until a point is done and then print it in one piece.
+std::vector<std::pair<std::vector<double>, double>> measure_private_points(
+    std::vector<BenchmarkParameters> const &parameters_sequence,
+    ChainGenerator generate, std::string const &point_name) {
+  std::vector<std::pair<std::vector<double>, double>> measured(
+      parameters_sequence.size(),
+      {{}, std::numeric_limits<double>::quiet_NaN()});
+  std::vector<size_t> indices;
+  uint64_t arena_length = 0;
+  bool replaying = true;
+  for (size_t i = 0; i < parameters_sequence.size(); i++) {
+    auto [stride, arr_size] = parameters_sequence[i];
+    replaying = replaying &&
+                will_replay(i, point_tag(point_name, stride, arr_size));
+    uint64_t footprint = get_footprint(parameters_sequence[i]);
+    if (footprint <= scheduler.private_cache_size && !replaying) {
+      indices.push_back(i);
+      arena_length = std::max(arena_length, footprint);
+    }
+  }
+  if (indices.empty() || scheduler.cpus.empty()) {
+    return measured;
+  }
+  std::cerr << "\nMeasuring " << indices.size() << " points on "
+            << scheduler.cpus.size() << " cores" << std::endl;
+  std::atomic<size_t> next = 0;
+  std::mutex log_mutex;
+  std::vector<std::thread> workers;
+  for (int cpu : scheduler.cpus) {
+    workers.emplace_back([&, cpu]() {
+      pin_to_cpus({cpu});
+      std::ostringstream log;
+      auto flush_log = [&]() {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::cerr << log.str();
+        log.str("");
+      };
+      // Allocated after pinning so that the pages are local to the core
+      auto arr = allocate_array(arena_length, log);
+      flush_log();
+      for (size_t i = next++; i < indices.size(); i = next++) {
+        auto [stride, arr_size] = parameters_sequence[indices[i]];
+        log << "\nCPU " << cpu << ": stride = " << stride
+            << ", array size = " << arr_size << std::endl;
+        generate(arr, stride, arr_size);
+        auto &[samples, result] = measured[indices[i]];
+        result = sample_until_converges(
+            [arr, &log]() { return benchmark(arr, log); }, samples, log);
+        flush_log();
+      }
+      free((void *)arr);
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return measured;
 }
 
+// Points are checkpointed and reported as `point_name`, so that sweeps run
+// under different conditions do not replay each other. Rows are latency
+// rows either way.
 std::vector<BenchmarkResult>
 run_benchmarks(volatile uint8_t *arr,
-               std::vector<BenchmarkParameters> const &parameters_sequence) {
+               std::vector<BenchmarkParameters> const &parameters_sequence,
+               ChainGenerator generate = generate_chain,
+               std::string const &point_name = "latency") {
+  auto measured =
+      measure_private_points(parameters_sequence, generate, point_name);
   std::vector<BenchmarkResult> results;
   double prev_result = 1.0;
+  bool has_prev = false;
   for (BenchmarkParameters param : parameters_sequence) {
     BenchmarkResult benchmark_result;
     std::cerr << "\nStride = " << param.stride
               << ", array size = " << param.arr_size << std::endl;
-    generate_chain(arr, param.stride, param.arr_size);
-    double current_result = run_benchmark_until_converges(arr);
+    double current_result;
+    auto point = point_tag(point_name, param.stride, param.arr_size);
+    auto const &[samples, parallel_result] = measured[results.size()];
+    bool measured_in_parallel = !samples.empty();
+    if (!measured_in_parallel || is_open(trace_log)) {
+      generate(arr, param.stride, param.arr_size);
+      trace_chain(arr);
+    }
+    double error;
+    if (measured_in_parallel) {
+      current_result = parallel_result;
+      error = cachegeom::get_standard_error(samples);
+      std::cerr << "Measured in parallel: " << current_result << std::endl;
+      // At all-core rather than single-core turbo, which is worth telling
+      // apart when `increase` jumps right after the last of these
+      record_result(point, current_result);
+      emit_point(point, samples, current_result, "running_mean_parallel");
+    } else {
+      // Budgeted points share what is left of the phase equally
+      auto now = std::chrono::steady_clock::now();
+      auto n_points_left =
+          (long)(parameters_sequence.size() - results.size());
+      measurement.point_deadline = std::max(
+          now, now + (measurement.phase_deadline - now) / n_points_left);
+      current_result = measure_benchmark(point, arr, error);
+    }
     benchmark_result.parameters = param;
     benchmark_result.result = current_result;
+    benchmark_result.error = error;
+    // Points after failed ones compare to the last measured one, and have
+    // no increase if there is none
     benchmark_result.increase =
-        ((double)current_result) / ((double)prev_result);
+        results.empty() || has_prev
+            ? ((double)current_result) / ((double)prev_result)
+            : std::numeric_limits<double>::quiet_NaN();
     results.push_back(benchmark_result);
 
-    std::cout << param.stride << "," << param.arr_size << "," << current_result
-              << "," << benchmark_result.increase << std::endl;
-    prev_result = current_result;
+    print_result("latency", 1, benchmark_result);
+    if (!is_failed(current_result)) {
+      prev_result = current_result;
+      has_prev = true;
+    }
   }
 
   return results;
@@ -182,95 +1137,2687 @@ get_strides_parameters_sequence(int min_stride, int max_stride,
   return parameters_sequence;
 }
 
-int find_cache_line(volatile uint8_t *arr) {
-  auto params = get_strides_parameters_sequence(MIN_CACHELINE_SIZE,
-                                                MAX_CACHELINE_SIZE, ARR_LENGTH);
-  auto results = run_benchmarks(arr, params);
-  auto result_stride = find_first_performance_spike(results);
-  if (result_stride != -1) {
-    return result_stride;
-  } else {
-    std::cerr
-        << "Could not detect cache line size: no performance spikes detected!"
-        << std::endl;
-    std::exit(1);
-  }
-}
-
-uint64_t find_cache_size(volatile uint8_t *arr, int cache_line_size) {
-  int stride = 2 * cache_line_size;
-  // 1. Form a sequence
+std::vector<BenchmarkParameters>
+get_sizes_parameters_sequence(int stride, uint64_t min_arr_size,
+                              uint64_t max_arr_size, uint64_t step) {
   std::vector<BenchmarkParameters> parameters_sequence;
-  for (int arr_length = MIN_CACHESIZE; arr_length <= MAX_CACHESIZE;
-       arr_length += CACHESIZE_STEP) {
+  for (uint64_t arr_size = min_arr_size; arr_size <= max_arr_size;
+       arr_size += step) {
     BenchmarkParameters params;
     params.stride = stride;
-    params.arr_size = arr_length;
+    params.arr_size = arr_size;
     parameters_sequence.push_back(params);
   }
-  // 2. Run experiments
-  auto results = run_benchmarks(arr, parameters_sequence);
-  // 3. Analyze results
-  double prev_result = results[0].result;
+  return parameters_sequence;
+}
+
+// Measures the points of a libcachegeom phase like any other sweep and finds
+// the knee the library would. Returns 0 if there is none.
+double run_geometry_phase(volatile uint8_t *arr,
+                          cachegeom::Phase const &phase,
+                          std::string const &name,
+                          std::string const &description,
+                          std::string const &point_name = "latency") {
+  std::vector<BenchmarkParameters> parameters_sequence;
+  for (auto const &point : phase.points) {
+    parameters_sequence.push_back(
+        {.stride = point.stride, .arr_size = point.size});
+  }
+  auto results =
+      run_benchmarks(arr, parameters_sequence, phase.generate, point_name);
+  std::vector<double> latencies;
+  std::vector<double> errors;
+  for (auto const &result : results) {
+    latencies.push_back(result.result);
+    errors.push_back(result.error);
+  }
+  auto detection = cachegeom::find_knee(phase, latencies, errors);
+  if (detection.value == 0) {
+    report_not_detected(description, results);
+    return 0;
+  }
+  std::cerr << "Detected " << description << " " << detection.value
+            << ", between " << detection.low << " and " << detection.high
+            << " within two standard errors" << std::endl;
+  emit_detection(name, detection);
+  return detection.value;
+}
+
+// The phases of libcachegeom over an arena of at least CACHEGEOM_ARENA_SIZE
+// bytes. Each returns 0 if nothing was found.
+int find_cache_line(volatile uint8_t *arr) {
+  return run_geometry_phase(arr, cachegeom::get_line_phase(),
+                            "cache_line_size", "cache line size");
+}
+
+uint64_t find_cache_size(volatile uint8_t *arr, int cache_line_size,
+                         uint64_t min_size = MIN_CACHESIZE,
+                         std::string const &point_name = "latency") {
+  return run_geometry_phase(
+      arr, cachegeom::get_size_phase(cache_line_size, min_size),
+      "cache_size", "cache size", point_name);
+}
+
+int find_associativity(volatile uint8_t *arr, int cache_line_size) {
+  return run_geometry_phase(
+      arr, cachegeom::get_associativity_phase(cache_line_size),
+      "associativity", "associativity");
+}
+
+struct TlbGeometry {
+  uint64_t page_size;
+  uint64_t l1_entries;
+  uint64_t l2_entries;
+  uint64_t l1_associativity;
+  uint64_t l2_associativity;
+  double l1_miss_ns;
+  double page_walk_ns;
+};
+
+double to_ns_per_access(double result) { return result / N_ACCESSES; }
+
+// Indices of the points that are slower than their predecessor by at least
+// `ratio`. The first point has no predecessor and is never a spike.
+std::vector<size_t> find_spikes(std::vector<BenchmarkResult> const &results,
+                                double ratio) {
+  std::vector<size_t> spikes;
   for (size_t i = 1; i < results.size(); i++) {
-    auto diff = results[i].result - prev_result;
-    if (diff >= CACHESIZE_JUMP_THRESHOLD) {
-      return results[i].parameters.arr_size;
+    if (results[i].increase >= ratio) {
+      spikes.push_back(i);
     }
   }
-  std::cerr << "Could not detect cache size!" << std::endl;
-  std::exit(1);
+  return spikes;
 }
 
-int find_associativity(volatile uint8_t *arr, int cache_line_size,
-                       uint64_t cache_size) {
-  int stride = cache_line_size * MAX_N_SETS;
-  // 1. Form a sequence
+// The biggest spike after the first one is taken as the second-level TLB
+// running out: page walks cost far more than an STLB hit or an L2 data miss.
+size_t find_largest_spike_after(std::vector<BenchmarkResult> const &results,
+                                std::vector<size_t> const &spikes,
+                                size_t after) {
+  size_t largest = 0;
+  for (size_t spike : spikes) {
+    if (spike > after &&
+        (largest == 0 || results[spike].increase > results[largest].increase)) {
+      largest = spike;
+    }
+  }
+  return largest;
+}
+
+// Every node sits on its own page; the node offset inside the page moves by
+// one cache line per page so that the chain does not alias into one L1 set.
+uint64_t get_tlb_stride(uint64_t page_size, uint64_t pages_between_nodes,
+                        int cache_line_size) {
+  return page_size * pages_between_nodes + cache_line_size;
+}
+
+void find_tlb_entries(volatile uint8_t *arr, uint64_t arr_length,
+                      int cache_line_size, TlbGeometry &geometry) {
+  int stride = get_tlb_stride(geometry.page_size, 1, cache_line_size);
+  // 1. Form a sequence, four points per doubling of the page count
   std::vector<BenchmarkParameters> parameters_sequence;
-  for (uint64_t assumed_associativity = 4; assumed_associativity <= 16;
-       assumed_associativity += 2) {
+  for (uint64_t n_pages = TLB_MIN_PAGES;
+       n_pages <= TLB_MAX_PAGES && n_pages * stride <= arr_length;
+       n_pages += n_pages / 4) {
     BenchmarkParameters params = {.stride = stride,
-                                  .arr_size = assumed_associativity * stride};
+                                  .arr_size = n_pages * stride};
     parameters_sequence.push_back(params);
   }
+  uint64_t max_pages = parameters_sequence.back().arr_size / stride;
+  if (max_pages * 5 / 4 <= TLB_MAX_PAGES) {
+    std::cerr << "The arena only holds " << max_pages << " pages of "
+              << geometry.page_size << " bytes, larger TLBs are not detected"
+              << std::endl;
+  }
   // 2. Run experiments
   auto results = run_benchmarks(arr, parameters_sequence);
   // 3. Analyze results
-  double prev_result = results[0].result;
-  for (size_t i = 1; i < results.size(); i++) {
-    auto diff = results[i].result - prev_result;
-    if (diff >= 1.5 * 1e8) {
-      uint64_t assumed_associativity = results[i].parameters.arr_size / stride;
-      uint64_t assumed_n_sets =
-          cache_size / (assumed_associativity * cache_line_size);
-      uint64_t rounded_n_sets = 1 << (std::bit_width(assumed_n_sets) - 1);
-      uint64_t rounded_associativity =
-          (cache_size / rounded_n_sets) / cache_line_size;
-      return rounded_associativity;
-    }
+  auto spikes = find_spikes(results, TLB_JUMP_RATIO);
+  if (spikes.empty()) {
+    std::cerr << "Could not detect TLB size: no performance spikes detected!"
+              << std::endl;
+    return;
+  }
+  size_t l1_spike = spikes[0];
+  geometry.l1_entries = results[l1_spike - 1].parameters.arr_size / stride;
+  size_t l2_spike = find_largest_spike_after(results, spikes, l1_spike);
+  if (l2_spike == 0) {
+    std::cerr << "Could not detect second-level TLB size" << std::endl;
+    return;
   }
-  std::cerr << "Could not detect associativity!" << std::endl;
-  std::exit(1);
+  geometry.l2_entries = results[l2_spike - 1].parameters.arr_size / stride;
+  geometry.l1_miss_ns = to_ns_per_access(results[l2_spike - 1].result) -
+                        to_ns_per_access(results[l1_spike - 1].result);
+  geometry.page_walk_ns = to_ns_per_access(results.back().result) -
+                          to_ns_per_access(results[l2_spike - 1].result);
 }
 
-int main() {
-  auto arr = allocate_array();
-
-  std::cout << "stride,arr_size,result,increase" << std::endl;
-
-  // 49152
-  int cache_line_size = find_cache_line(arr);
-  std::cerr << "Result: cache line size is " << cache_line_size << std::endl;
-
-  uint64_t cache_size = find_cache_size(arr, cache_line_size);
-  std::cerr << "Result: cache size is " << cache_size << std::endl;
-
-  int associativity = find_associativity(arr, 64, 49152);
-  std::cerr << "Result: associativity is " << associativity << std::endl;
+// Same trick as find_associativity: nodes spaced by the TLB entry count
+// (rounded up to a power of two) all map to one TLB set, so the chain starts
+// missing as soon as it is longer than the number of ways.
+std::vector<BenchmarkResult> run_tlb_associativity(volatile uint8_t *arr,
+                                                   uint64_t arr_length,
+                                                   int cache_line_size,
+                                                   uint64_t page_size,
+                                                   uint64_t entries) {
+  uint64_t pages_between_nodes = (uint64_t)1 << std::bit_width(entries - 1);
+  uint64_t stride =
+      get_tlb_stride(page_size, pages_between_nodes, cache_line_size);
+  // With huge pages a second-level TLB of a thousand entries already spaces
+  // the nodes gigabytes apart
+  if (2 * stride > arr_length ||
+      stride > (uint64_t)std::numeric_limits<int>::max()) {
+    std::cerr << "Nodes aliasing in a TLB of " << entries << " entries are "
+              << stride << " bytes apart, two of them do not fit into "
+              << arr_length << " bytes, skipping associativity" << std::endl;
+    return {};
+  }
+  // 1. Form a sequence
+  std::vector<BenchmarkParameters> parameters_sequence;
+  for (uint64_t n_nodes = 2;
+       n_nodes <= TLB_MAX_WAYS && n_nodes * stride <= arr_length; n_nodes++) {
+    BenchmarkParameters params = {.stride = (int)stride,
+                                  .arr_size = n_nodes * stride};
+    parameters_sequence.push_back(params);
+  }
+  if (parameters_sequence.size() < 2) {
+    std::cerr << "TLB of " << entries << " entries does not fit into "
+              << arr_length << " bytes, skipping associativity" << std::endl;
+    return {};
+  }
+  // 2. Run experiments
+  return run_benchmarks(arr, parameters_sequence);
+}
+
+void find_tlb_associativity(volatile uint8_t *arr, uint64_t arr_length,
+                            int cache_line_size, TlbGeometry &geometry) {
+  if (geometry.l1_entries != 0) {
+    auto results = run_tlb_associativity(arr, arr_length, cache_line_size,
+                                         geometry.page_size,
+                                         geometry.l1_entries);
+    auto spikes = find_spikes(results, TLB_JUMP_RATIO);
+    if (!spikes.empty()) {
+      geometry.l1_associativity =
+          results[spikes[0] - 1].parameters.arr_size /
+          results[0].parameters.stride;
+    }
+  }
+  if (geometry.l2_entries != 0) {
+    // Nodes aliasing in the STLB alias in the dTLB as well, so the first
+    // spike belongs to the dTLB and the second-level one comes after it
+    auto results = run_tlb_associativity(arr, arr_length, cache_line_size,
+                                         geometry.page_size,
+                                         geometry.l2_entries);
+    auto spikes = find_spikes(results, TLB_JUMP_RATIO);
+    if (!spikes.empty()) {
+      size_t l2_spike = find_largest_spike_after(results, spikes, spikes[0]);
+      if (l2_spike != 0) {
+        geometry.l2_associativity = results[l2_spike - 1].parameters.arr_size /
+                                    results[0].parameters.stride;
+      }
+    }
+  }
+}
+
+TlbGeometry find_tlb_geometry(int cache_line_size, bool huge_pages) {
+  TlbGeometry geometry = {};
+  geometry.page_size = huge_pages ? HUGE_PAGE_SIZE : sysconf(_SC_PAGE_SIZE);
+  // Huge pages need a larger arena to reach a second-level TLB of a few
+  // thousand entries
+  uint64_t arena_length =
+      huge_pages ? TLB_HUGE_ARENA_LENGTH : TLB_ARENA_LENGTH;
+  auto arr = allocate_pages(arena_length, huge_pages);
+  find_tlb_entries(arr, arena_length, cache_line_size, geometry);
+  find_tlb_associativity(arr, arena_length, cache_line_size, geometry);
+  free_pages(arr, arena_length);
+  return geometry;
+}
+
+void print_tlb_geometry(TlbGeometry const &geometry) {
+  std::cerr << std::endl
+            << "Page size:             " << geometry.page_size << std::endl
+            << "L1 dTLB entries:       " << geometry.l1_entries << std::endl
+            << "L1 dTLB associativity: " << geometry.l1_associativity
+            << std::endl
+            << "L2 STLB entries:       " << geometry.l2_entries << std::endl
+            << "L2 STLB associativity: " << geometry.l2_associativity
+            << std::endl
+            << "L1 dTLB miss, ns:      " << geometry.l1_miss_ns << std::endl
+            << "Page walk, ns:         " << geometry.page_walk_ns << std::endl;
+}
+
+void run_tlb_mode() {
+  print_csv_header();
+  // Shifting nodes by the largest plausible line keeps them in distinct sets
+  // without paying for a full find_cache_line run first
+  auto small_pages = find_tlb_geometry(MAX_CACHELINE_SIZE, false);
+  auto huge_pages = find_tlb_geometry(MAX_CACHELINE_SIZE, true);
+  print_tlb_geometry(small_pages);
+  print_tlb_geometry(huge_pages);
+}
+
+struct BandwidthBenchmark {
+  const char *name;
+  BandwidthKernel kernel;
+  // Bytes moved between the core and the memory per byte of the buffer
+  int traffic_per_byte;
+};
+
+const BandwidthBenchmark BANDWIDTH_BENCHMARKS[] = {
+    {"read", bandwidth_read, 1},   {"write", bandwidth_write, 1},
+    {"rmw", bandwidth_rmw, 2},     {"copy", bandwidth_copy, 1},
+    {"nt_write", bandwidth_nt_write, 1},
+};
+
+struct BandwidthWorkingSet {
+  uint64_t size;
+  // Private levels get `size` bytes per thread, shared ones split it
+  bool is_private;
+};
+
+struct CacheLevel {
+  const char *name;
+  uint64_t size;
+};
+
+// Data cache sizes as reported by CPUID via glibc, the defaults cover hosts
+// where it reports nothing
+std::vector<CacheLevel> get_cache_levels() {
+  long l1_size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+  long l2_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  long l3_size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  return {
+      {"L1", l1_size > 0 ? (uint64_t)l1_size : DEFAULT_L1_SIZE},
+      {"L2", l2_size > 0 ? (uint64_t)l2_size : DEFAULT_L2_SIZE},
+      {"L3", l3_size > 0 ? (uint64_t)l3_size : DEFAULT_L3_SIZE},
+  };
+}
+
+// One working set per cache level plus one that only fits in DRAM. Each is
+// half of the level so that the previous level's victims and the page tables
+// do not push the stream out.
+std::vector<BandwidthWorkingSet> get_bandwidth_working_sets() {
+  auto levels = get_cache_levels();
+  return {
+      {levels[0].size / 2, true},
+      {levels[1].size / 2, true},
+      {levels[2].size / 2, false},
+      {BANDWIDTH_DRAM_SIZE, false},
+  };
+}
+
+// Runs `kernel` on `n_threads` threads, each over its own `arr_size` bytes of
+// the arena, and returns the time until the last of them finishes in ns
+long long benchmark_bandwidth(volatile uint8_t *arr, BandwidthKernel kernel,
+                              uint64_t arr_size, uint64_t n_passes,
+                              int n_threads) {
+  long page_size = sysconf(_SC_PAGE_SIZE);
+  uint64_t region_size = (arr_size + page_size - 1) / page_size * page_size;
+  std::barrier start_barrier(n_threads + 1);
+  std::atomic<uint64_t> acc = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < n_threads; i++) {
+    threads.emplace_back([&, i]() {
+      start_barrier.arrive_and_wait();
+      acc += kernel((uint8_t *)arr + i * region_size, arr_size, n_passes);
+    });
+  }
+  start_barrier.arrive_and_wait();
+  auto start = std::chrono::steady_clock::now();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+void run_bandwidth_benchmarks(volatile uint8_t *arr,
+                              BandwidthBenchmark const &bandwidth_benchmark,
+                              int n_threads) {
+  double prev_result = 1.0;
+  for (auto working_set : get_bandwidth_working_sets()) {
+    uint64_t arr_size = working_set.is_private
+                            ? working_set.size
+                            : working_set.size / n_threads;
+    uint64_t n_passes = std::max(BANDWIDTH_BYTES_PER_RUN / arr_size, 1UL);
+    std::cerr << "\n" << bandwidth_benchmark.name << " bandwidth, threads = "
+              << n_threads << ", array size = " << arr_size << std::endl;
+    auto point = point_tag(bandwidth_benchmark.name, n_threads, arr_size);
+    double elapsed_ns = measure(point, [&]() {
+      return benchmark_bandwidth(arr, bandwidth_benchmark.kernel, arr_size,
+                                 n_passes, n_threads);
+    });
+    double traffic = (double)arr_size * n_passes * n_threads *
+                     bandwidth_benchmark.traffic_per_byte;
+
+    BenchmarkResult benchmark_result;
+    benchmark_result.parameters = {.stride = BANDWIDTH_ACCESS_SIZE,
+                                   .arr_size = arr_size};
+    benchmark_result.result = traffic / elapsed_ns;
+    benchmark_result.increase = benchmark_result.result / prev_result;
+    print_result(bandwidth_benchmark.name, n_threads, benchmark_result);
+    std::cerr << "Result: " << bandwidth_benchmark.name << " bandwidth is "
+              << benchmark_result.result << " GB/s" << std::endl;
+    prev_result = benchmark_result.result;
+  }
+}
+
+void run_bandwidth_mode() {
+  auto arr = allocate_array();
+  print_csv_header();
+
+  std::vector<int> thread_counts = {1};
+  int n_cpus = std::thread::hardware_concurrency();
+  if (n_cpus > 1) {
+    thread_counts.push_back(n_cpus);
+  }
+  for (int n_threads : thread_counts) {
+    for (auto const &bandwidth_benchmark : BANDWIDTH_BENCHMARKS) {
+      run_bandwidth_benchmarks(arr, bandwidth_benchmark, n_threads);
+    }
+  }
+}
+
+typedef uint64_t (*ChaseKernel)(uint8_t *start, uint64_t n_accesses);
+
+// Same as benchmark(), but the chase itself is done by `kernel`
+long long benchmark_chase(volatile uint8_t *arr, ChaseKernel kernel) {
+  auto start = std::chrono::steady_clock::now();
+  auto acc = kernel((uint8_t *)arr, N_ACCESSES);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+struct SimdChase {
+  const char *name;
+  int width;
+  ChaseKernel kernel;
+};
+
+const SimdChase SIMD_CHASES[] = {
+    {"latency_scalar", 8, scalar_chase},
+    {"latency_simd16", 16, simd_chase_16},
+    {"latency_simd32", 32, simd_chase_32},
+    {"latency_simd64", 64, simd_chase_64},
+    {"latency_gather32", 32, gather_chase_32},
+    {"latency_gather64", 64, gather_chase_64},
+};
+
+struct SimdRead {
+  const char *name;
+  int width;
+  BandwidthKernel kernel;
+};
+
+const SimdRead SIMD_READS[] = {
+    {"read_simd16", 16, bandwidth_read},
+    {"read_simd32", 32, simd_read_32},
+    {"read_simd64", 64, simd_read_64},
+};
+
+// Latency rows use the scalar chase over the same chain as `increase` base,
+// so that it reads as the wide-load penalty factor
+void run_simd_latency_benchmarks(volatile uint8_t *arr, uint64_t arr_size) {
+  generate_chain(arr, SIMD_NODE_STRIDE, arr_size);
+  double scalar_result = 0;
+  for (auto const &chase : SIMD_CHASES) {
+    if (!simd_supports(chase.width)) {
+      std::cerr << "Skipping " << chase.name << ": no " << chase.width
+                << "-byte vectors on this CPU" << std::endl;
+      continue;
+    }
+    std::cerr << "\n" << chase.name << ", array size = " << arr_size
+              << std::endl;
+    BenchmarkResult benchmark_result;
+    benchmark_result.parameters = {.stride = SIMD_NODE_STRIDE,
+                                   .arr_size = arr_size};
+    benchmark_result.result =
+        measure(point_tag(chase.name, SIMD_NODE_STRIDE, arr_size),
+                [&]() { return benchmark_chase(arr, chase.kernel); });
+    if (scalar_result == 0) {
+      scalar_result = benchmark_result.result;
+    }
+    benchmark_result.increase = benchmark_result.result / scalar_result;
+    print_result(chase.name, 1, benchmark_result);
+    std::cerr << "Result: " << chase.name << " costs "
+              << to_ns_per_access(benchmark_result.result - scalar_result)
+              << " ns per access over a scalar load" << std::endl;
+  }
+}
+
+// Bandwidth rows use the 16-byte kernel as `increase` base
+void run_simd_throughput_benchmarks(volatile uint8_t *arr, uint64_t arr_size) {
+  uint64_t n_passes = std::max(BANDWIDTH_BYTES_PER_RUN / arr_size, 1UL);
+  double base_result = 0;
+  for (auto const &read : SIMD_READS) {
+    if (!simd_supports(read.width)) {
+      std::cerr << "Skipping " << read.name << ": no " << read.width
+                << "-byte vectors on this CPU" << std::endl;
+      continue;
+    }
+    std::cerr << "\n" << read.name << ", array size = " << arr_size
+              << std::endl;
+    double elapsed_ns =
+        measure(point_tag(read.name, read.width, arr_size), [&]() {
+          return benchmark_bandwidth(arr, read.kernel, arr_size, n_passes, 1);
+        });
+    BenchmarkResult benchmark_result;
+    benchmark_result.parameters = {.stride = read.width, .arr_size = arr_size};
+    benchmark_result.result = (double)arr_size * n_passes / elapsed_ns;
+    if (base_result == 0) {
+      base_result = benchmark_result.result;
+    }
+    benchmark_result.increase = benchmark_result.result / base_result;
+    print_result(read.name, 1, benchmark_result);
+    std::cerr << "Result: " << read.name << " L1 bandwidth is "
+              << benchmark_result.result << " GB/s" << std::endl;
+  }
+}
+
+void run_simd_mode() {
+  auto arr = allocate_array();
+  print_csv_header();
+  uint64_t l1_working_set = get_bandwidth_working_sets()[0].size;
+  run_simd_latency_benchmarks(arr, l1_working_set);
+  run_simd_throughput_benchmarks(arr, l1_working_set);
+}
+
+// Line size as reported by CPUID via glibc, for modes that only need it to
+// place data and not to measure it
+int get_cache_line_size() {
+  long cache_line_size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+  return cache_line_size > 0 ? cache_line_size : DEFAULT_CACHELINE_SIZE;
+}
+
+// Of L1d. glibc reports 0 where it does not know and -1 where it cannot ask,
+// as in many VMs.
+int get_associativity() {
+  long associativity = sysconf(_SC_LEVEL1_DCACHE_ASSOC);
+  return associativity > 0 ? associativity : DEFAULT_ASSOCIATIVITY;
+}
+
+struct SplitCase {
+  const char *name;
+  int stride;
+  uint64_t arr_size;
+  // Offset of every node from its stride-aligned position
+  int offset;
+};
+
+// Chases the chain shifted by `offset` bytes, which makes every pointer
+// unaligned, and returns the converged result
+BenchmarkResult run_split_benchmark(volatile uint8_t *arr,
+                                    SplitCase const &split_case) {
+  std::cerr << "\n" << split_case.name << ", stride = " << split_case.stride
+            << ", offset = " << split_case.offset << std::endl;
+  generate_chain(arr + split_case.offset, split_case.stride,
+                 split_case.arr_size);
+  BenchmarkResult benchmark_result;
+  benchmark_result.parameters = {.stride = split_case.stride,
+                                 .arr_size = split_case.arr_size};
+  benchmark_result.result = measure_benchmark(
+      point_tag(split_case.name, split_case.stride, split_case.offset),
+      arr + split_case.offset);
+  benchmark_result.increase = 1.0;
+  return benchmark_result;
+}
+
+// Runs the aligned case and its split counterpart and reports the split one
+// with `increase` relative to the aligned one
+void run_split_pair(volatile uint8_t *arr, SplitCase const &aligned_case,
+                    SplitCase const &split_case) {
+  auto aligned_result = run_split_benchmark(arr, aligned_case);
+  print_result(aligned_case.name, 1, aligned_result);
+  auto split_result = run_split_benchmark(arr, split_case);
+  split_result.increase = split_result.result / aligned_result.result;
+  print_result(split_case.name, 1, split_result);
+  std::cerr << "Result: " << split_case.name << " costs "
+            << to_ns_per_access(split_result.result - aligned_result.result)
+            << " ns per access" << std::endl;
+}
+
+long long benchmark_store_load(volatile uint8_t *store_ptr,
+                               volatile uint8_t *load_ptr) {
+  auto start = std::chrono::steady_clock::now();
+  auto acc =
+      store_load_pair((uint8_t *)store_ptr, (uint8_t *)load_ptr, N_ACCESSES);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+// The load either shares the low 12 bits with the store or is one line
+// further; both addresses are in different lines and never overlap
+void run_4k_aliasing_benchmarks(volatile uint8_t *arr, int cache_line_size) {
+  long page_size = sysconf(_SC_PAGE_SIZE);
+  std::pair<const char *, volatile uint8_t *> load_ptrs[] = {
+      {"store_load_distinct", arr + page_size + cache_line_size},
+      {"store_load_4k_alias", arr + page_size},
+  };
+  double distinct_result = 0;
+  for (auto [name, load_ptr] : load_ptrs) {
+    std::cerr << "\n" << name << std::endl;
+    BenchmarkResult benchmark_result;
+    benchmark_result.parameters = {.stride = (int)(load_ptr - arr),
+                                   .arr_size = (uint64_t)page_size * 2};
+    benchmark_result.result =
+        measure(point_tag(name, load_ptr - arr, page_size * 2),
+                [&]() { return benchmark_store_load(arr, load_ptr); });
+    if (distinct_result == 0) {
+      distinct_result = benchmark_result.result;
+    }
+    benchmark_result.increase = benchmark_result.result / distinct_result;
+    print_result(name, 1, benchmark_result);
+    std::cerr << "Result: " << name << " costs "
+              << to_ns_per_access(benchmark_result.result - distinct_result)
+              << " ns per iteration over distinct addresses" << std::endl;
+  }
+}
+
+void run_split_mode() {
+  auto arr = allocate_array();
+  print_csv_header();
+  int cache_line_size = get_cache_line_size();
+  int page_size = sysconf(_SC_PAGE_SIZE);
+  int line_stride = 2 * cache_line_size;
+  uint64_t page_arr_size = (uint64_t)PAGE_SPLIT_N_NODES * page_size;
+
+  // Every node straddles two lines of the same page
+  run_split_pair(arr, {"latency_line_aligned", line_stride, SPLIT_ARR_SIZE, 0},
+                 {"latency_line_split", line_stride, SPLIT_ARR_SIZE,
+                  cache_line_size - SPLIT_ACCESS_SIZE / 2});
+  // Every node straddles two pages. Such lines always fall into the first and
+  // last L1 sets, hence only a handful of nodes
+  run_split_pair(arr, {"latency_page_aligned", page_size, page_arr_size, 0},
+                 {"latency_page_split", page_size, page_arr_size,
+                  page_size - SPLIT_ACCESS_SIZE / 2});
+  run_4k_aliasing_benchmarks(arr, cache_line_size);
+}
+
+long long benchmark_cycle_loop() {
+  auto start = std::chrono::steady_clock::now();
+  auto acc = cycle_loop(N_ACCESSES);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+// Core clock as seen by the running thread, which is what converts
+// throughput to per-cycle numbers regardless of turbo and TSC rate
+double measure_cycles_per_ns() {
+  std::cerr << "\nCalibrating the core clock" << std::endl;
+  double elapsed_ns =
+      measure(point_tag("cycle_loop", 0, N_ACCESSES), benchmark_cycle_loop);
+  double cycles_per_ns = N_ACCESSES / elapsed_ns;
+  std::cerr << "Result: core runs at " << cycles_per_ns << " GHz" << std::endl;
+  return cycles_per_ns;
+}
+
+long long benchmark_load_throughput(volatile uint8_t *arr,
+                                    uint64_t const *offsets) {
+  auto start = std::chrono::steady_clock::now();
+  auto acc = load_throughput((uint8_t *)arr, offsets,
+                             N_ACCESSES / PORTS_N_LOADS);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+// Distances between consecutive loads of one iteration. Loads within one
+// line never conflict; loads at the same offset of different lines hit the
+// same bank; the extra 8 bytes move every load to the next bank.
+std::vector<int> get_load_port_steps(int cache_line_size, int page_size) {
+  return {0,
+          PORTS_ACCESS_SIZE,
+          cache_line_size / 2,
+          cache_line_size,
+          cache_line_size + PORTS_ACCESS_SIZE,
+          2 * cache_line_size,
+          2 * cache_line_size + PORTS_ACCESS_SIZE,
+          page_size,
+          page_size + PORTS_ACCESS_SIZE};
+}
+
+void run_ports_mode() {
+  auto arr = allocate_array();
+  print_csv_header();
+  int cache_line_size = get_cache_line_size();
+  int page_size = sysconf(_SC_PAGE_SIZE);
+  double cycles_per_ns = measure_cycles_per_ns();
+
+  std::vector<BenchmarkResult> results;
+  double prev_result = 1.0;
+  for (int step : get_load_port_steps(cache_line_size, page_size)) {
+    uint64_t offsets[PORTS_N_LOADS];
+    for (int i = 0; i < PORTS_N_LOADS; i++) {
+      offsets[i] = (uint64_t)i * step;
+    }
+    std::cerr << "\nLoad throughput, step = " << step << std::endl;
+    double elapsed_ns =
+        measure(point_tag("load_throughput", step, PORTS_N_LOADS),
+                [&]() { return benchmark_load_throughput(arr, offsets); });
+    BenchmarkResult benchmark_result;
+    benchmark_result.parameters = {
+        .stride = step,
+        .arr_size = offsets[PORTS_N_LOADS - 1] + PORTS_ACCESS_SIZE};
+    // Loads per cycle
+    benchmark_result.result =
+        (double)(N_ACCESSES / PORTS_N_LOADS * PORTS_N_LOADS) /
+        (elapsed_ns * cycles_per_ns);
+    benchmark_result.increase = benchmark_result.result / prev_result;
+    print_result("load_throughput", 1, benchmark_result);
+    results.push_back(benchmark_result);
+    prev_result = benchmark_result.result;
+  }
+
+  auto best = std::max_element(results.begin(), results.end(),
+                               [](auto const &a, auto const &b) {
+                                 return a.result < b.result;
+                               });
+  std::cerr << std::endl
+            << "Sustained loads per cycle: " << best->result << std::endl;
+  for (auto const &result : results) {
+    if (result.result < BANK_CONFLICT_RATIO * best->result) {
+      std::cerr << "Conflict at step " << result.parameters.stride << ": "
+                << result.result << " loads per cycle" << std::endl;
+    }
+  }
+}
+
+BenchmarkResult make_result(int stride, uint64_t arr_size, double result,
+                            double base_result) {
+  BenchmarkResult benchmark_result;
+  benchmark_result.parameters = {.stride = stride, .arr_size = arr_size};
+  benchmark_result.result = result;
+  benchmark_result.increase = result / base_result;
+  return benchmark_result;
+}
+
+long long benchmark_store_forwarding(volatile uint8_t *arr) {
+  auto start = std::chrono::steady_clock::now();
+  auto acc = store_forward_chain((uint8_t *)arr, N_ACCESSES);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+void find_store_forwarding_latency(volatile uint8_t *arr,
+                                   double cycles_per_ns) {
+  std::cerr << "\nStore-to-load forwarding" << std::endl;
+  double ns = to_ns_per_access(
+      measure(point_tag("store_forwarding", sizeof(uint64_t), 0),
+              [&]() { return benchmark_store_forwarding(arr); }));
+  print_result("store_forwarding", 1,
+               make_result(sizeof(uint64_t), sizeof(uint64_t), ns, ns));
+  std::cerr << "Result: store-to-load forwarding takes " << ns << " ns, "
+            << ns * cycles_per_ns << " cycles" << std::endl;
+}
+
+long long benchmark_store_burst(volatile uint8_t *arr, uint64_t n_stores) {
+  auto chain_a = (uint8_t *)arr;
+  auto chain_b = chain_a + STORE_BUFFER_CHAIN_SIZE;
+  auto store_arr = chain_b + STORE_BUFFER_CHAIN_SIZE;
+  auto start = std::chrono::steady_clock::now();
+  auto acc = store_burst(chain_a, chain_b, store_arr, n_stores,
+                         STORE_BUFFER_ITERATIONS);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+// Two independent DRAM misses overlap only while everything issued between
+// them is still in flight. The stores between them cannot retire before the
+// first miss does, so the overlap ends when they fill the store buffer.
+// Whichever of the ROB or the store buffer is smaller is what this finds;
+// with one store and loop overhead per three uops it is the store buffer on
+// every core we know of.
+void find_store_buffer_capacity(volatile uint8_t *arr, int cache_line_size) {
+  generate_random_chain(arr, cache_line_size, STORE_BUFFER_CHAIN_SIZE);
+  generate_random_chain(arr + STORE_BUFFER_CHAIN_SIZE, cache_line_size,
+                        STORE_BUFFER_CHAIN_SIZE);
+  double base_result = 0;
+  uint64_t capacity = 0;
+  bool stalled = false;
+  for (uint64_t n_stores = 0; n_stores <= STORE_BUFFER_MAX_STORES;
+       n_stores += STORE_BUFFER_STEP) {
+    std::cerr << "\nStore burst of " << n_stores << " stores" << std::endl;
+    auto point = point_tag("store_buffer", sizeof(uint64_t),
+                           n_stores * sizeof(uint64_t));
+    double ns = measure(point, [&]() {
+                  return benchmark_store_burst(arr, n_stores);
+                }) /
+                STORE_BUFFER_ITERATIONS;
+    if (base_result == 0) {
+      base_result = ns;
+    }
+    print_result("store_buffer", 1,
+                 make_result(sizeof(uint64_t), n_stores * sizeof(uint64_t),
+                             ns, base_result));
+    if (ns >= STORE_BUFFER_STALL_RATIO * base_result) {
+      capacity = n_stores - STORE_BUFFER_STEP;
+      stalled = true;
+      break;
+    }
+  }
+  if (!stalled) {
+    std::cerr << "Could not detect store buffer capacity: no stall up to "
+              << STORE_BUFFER_MAX_STORES << " stores" << std::endl;
+    return;
+  }
+  // The misses stop overlapping with the first burst already, which is not
+  // the store buffer on any core we know of
+  if (capacity == 0) {
+    std::cerr << "Could not detect store buffer capacity: stalled at the "
+              << "smallest burst of " << STORE_BUFFER_STEP << " stores"
+              << std::endl;
+    return;
+  }
+  std::cerr << "Result: store buffer holds at least " << capacity
+            << " stores" << std::endl;
+}
+
+enum class LineState { Evicted, Clean, Dirty };
+
+const char *to_string(LineState state) {
+  switch (state) {
+  case LineState::Evicted:
+    return "evicted";
+  case LineState::Clean:
+    return "clean";
+  case LineState::Dirty:
+    return "dirty";
+  }
+  return "";
+}
+
+struct WritePolicyLayout {
+  uint8_t *target;
+  uint64_t target_size;
+  // Reading this region pushes the target out of L1
+  uint8_t *evict;
+  uint64_t evict_size;
+  int cache_line_size;
+};
+
+// Puts the target lines out of L1 and then, unless `state` is Evicted, back
+// in by reading or by writing a word next to the chain pointer
+void prepare_target(WritePolicyLayout const &layout, LineState state) {
+  read_lines(layout.evict, layout.evict_size, layout.cache_line_size);
+  if (state == LineState::Clean) {
+    read_lines(layout.target, layout.target_size, layout.cache_line_size);
+  } else if (state == LineState::Dirty) {
+    write_lines(layout.target, layout.target_size, layout.cache_line_size,
+                sizeof(uint64_t));
+  }
+}
+
+// Time to chase the target after `state` was set up, in ns per line
+double measure_chase_after(WritePolicyLayout const &layout, LineState state) {
+  uint64_t n_lines = layout.target_size / layout.cache_line_size;
+  auto point = point_tag(std::string("write_allocate_") + to_string(state),
+                         layout.cache_line_size, layout.target_size);
+  auto elapsed_ns = measure(point, [&]() {
+    long long total_ns = 0;
+    uint64_t acc = 0;
+    for (int i = 0; i < WRITE_POLICY_ROUNDS; i++) {
+      prepare_target(layout, state);
+      auto start = std::chrono::steady_clock::now();
+      acc ^= scalar_chase(layout.target, n_lines);
+      auto end = std::chrono::steady_clock::now();
+      total_ns +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+              .count();
+    }
+    std::cerr << "benchmark acc=" << acc << std::endl;
+    return total_ns;
+  });
+  return elapsed_ns / WRITE_POLICY_ROUNDS / n_lines;
+}
+
+// Time to push the target out of L1 when its lines are `state`, in ns per
+// evicted line
+double measure_eviction_of(WritePolicyLayout const &layout, LineState state) {
+  uint64_t n_lines = layout.target_size / layout.cache_line_size;
+  auto point = point_tag(std::string("evict_") + to_string(state),
+                         layout.cache_line_size, layout.target_size);
+  auto elapsed_ns = measure(point, [&]() {
+    long long total_ns = 0;
+    uint64_t acc = 0;
+    for (int i = 0; i < WRITE_POLICY_ROUNDS; i++) {
+      prepare_target(layout, state);
+      auto start = std::chrono::steady_clock::now();
+      acc ^= read_lines(layout.evict, layout.evict_size,
+                        layout.cache_line_size);
+      auto end = std::chrono::steady_clock::now();
+      total_ns +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+              .count();
+    }
+    std::cerr << "benchmark acc=" << acc << std::endl;
+    return total_ns;
+  });
+  return elapsed_ns / WRITE_POLICY_ROUNDS / n_lines;
+}
+
+// A write-allocate L1 brings written lines in, so chasing them right after
+// the write costs as much as after a read. A write-back L1 keeps them dirty
+// and pays for writing them back when they are evicted.
+void find_write_policy(volatile uint8_t *arr, int cache_line_size) {
+  uint64_t target_size = get_cache_levels()[0].size / 2;
+  WritePolicyLayout layout = {
+      .target = (uint8_t *)arr,
+      .target_size = target_size,
+      .evict = (uint8_t *)arr + target_size,
+      .evict_size = WRITE_POLICY_EVICT_FACTOR * 2 * target_size,
+      .cache_line_size = cache_line_size,
+  };
+  generate_random_chain(arr, cache_line_size, target_size);
+
+  double chase_ns[3];
+  for (auto state : {LineState::Clean, LineState::Evicted, LineState::Dirty}) {
+    std::cerr << "\nChase after the target is " << to_string(state)
+              << std::endl;
+    double ns = measure_chase_after(layout, state);
+    chase_ns[(int)state] = ns;
+    print_result(std::string("write_allocate_") + to_string(state), 1,
+                 make_result(cache_line_size, target_size, ns,
+                             chase_ns[(int)LineState::Clean]));
+  }
+  double miss_cost = chase_ns[(int)LineState::Evicted] -
+                     chase_ns[(int)LineState::Clean];
+  double write_cost =
+      chase_ns[(int)LineState::Dirty] - chase_ns[(int)LineState::Clean];
+  bool write_allocate = write_cost < WRITE_ALLOCATE_FRACTION * miss_cost;
+
+  double evict_ns[3];
+  for (auto state : {LineState::Clean, LineState::Dirty}) {
+    std::cerr << "\nEviction of " << to_string(state) << " lines"
+              << std::endl;
+    double ns = measure_eviction_of(layout, state);
+    evict_ns[(int)state] = ns;
+    print_result(std::string("evict_") + to_string(state), 1,
+                 make_result(cache_line_size, target_size, ns,
+                             evict_ns[(int)LineState::Clean]));
+  }
+  bool write_back = evict_ns[(int)LineState::Dirty] >=
+                    WRITE_BACK_RATIO * evict_ns[(int)LineState::Clean];
+
+  std::cerr << "Result: L1 is " << (write_allocate ? "" : "not ")
+            << "write-allocate and "
+            << (write_back ? "write-back" : "write-through") << std::endl
+            << "Result: evicting a dirty line costs "
+            << evict_ns[(int)LineState::Dirty] - evict_ns[(int)LineState::Clean]
+            << " ns more than a clean one" << std::endl;
+}
+
+void run_store_mode() {
+  auto arr = allocate_array();
+  print_csv_header();
+  int cache_line_size = get_cache_line_size();
+  double cycles_per_ns = measure_cycles_per_ns();
+  find_store_forwarding_latency(arr, cycles_per_ns);
+  find_write_policy(arr, cache_line_size);
+  find_store_buffer_capacity(arr, cache_line_size);
+}
+
+// Capacity seen by a cyclic random chase that misses `lower` and hits
+// `upper`: about `upper` when the levels duplicate lines and about
+// `lower + upper` when `upper` only holds the victims of `lower`. The
+// sweep brackets both candidates and is anchored by one point well inside
+// `upper` and one well outside of it.
+uint64_t find_effective_capacity(volatile uint8_t *arr, int cache_line_size,
+                                 CacheLevel const &lower,
+                                 CacheLevel const &upper) {
+  uint64_t width = INCLUSION_SWEEP_WIDTH * lower.size;
+  uint64_t step = lower.size / INCLUSION_STEPS_PER_LOWER;
+  // 1. Form a sequence
+  std::vector<BenchmarkParameters> parameters_sequence = {
+      {.stride = cache_line_size, .arr_size = upper.size / 2}};
+  // `width` can exceed `upper` when the levels are close in size
+  uint64_t first = width < upper.size / 2 ? upper.size - width
+                                          : upper.size / 2;
+  auto sweep = get_sizes_parameters_sequence(cache_line_size, first,
+                                             upper.size + width, step);
+  parameters_sequence.insert(parameters_sequence.end(), sweep.begin(),
+                             sweep.end());
+  parameters_sequence.push_back(
+      {.stride = cache_line_size,
+       .arr_size = INCLUSION_STREAM_FACTOR * (lower.size + upper.size)});
+  // 2. Run experiments
+  auto results =
+      run_benchmarks(arr, parameters_sequence, generate_random_chain);
+  // 3. Analyze results
+  double inside = results.front().result;
+  double outside = results.back().result;
+  if (outside < INCLUSION_MIN_GAP_RATIO * inside) {
+    std::cerr << "Could not detect effective capacity: " << upper.name
+              << " is not faster than the level after it" << std::endl;
+    return 0;
+  }
+  double threshold = inside + INCLUSION_KNEE_FRACTION * (outside - inside);
+  for (size_t i = 1; i + 1 < results.size(); i++) {
+    if (results[i].result >= threshold) {
+      return results[i - 1].parameters.arr_size;
+    }
+  }
+  return results[results.size() - 2].parameters.arr_size;
+}
+
+long long benchmark_hot_set(uint8_t *hot, uint64_t hot_size, uint8_t *stream,
+                            uint64_t stream_size, int cache_line_size,
+                            bool chase_hot, bool read_stream) {
+  uint64_t n_hot_lines = hot_size / cache_line_size;
+  uint64_t chunk = INCLUSION_STREAM_LINES * cache_line_size;
+  uint64_t n_rounds = INCLUSION_STREAM_PASSES * stream_size / chunk;
+  uint64_t acc = 0;
+  uint64_t position = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < n_rounds; i++) {
+    if (chase_hot) {
+      acc ^= scalar_chase(hot, n_hot_lines);
+    }
+    if (read_stream) {
+      acc ^= read_lines(stream + position, chunk, cache_line_size);
+      position = (position + chunk) % stream_size;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+// A hot set that lives in `lower` is chased over and over while a stream
+// twice the size of `upper` flows past it. `upper` never sees the hot hits,
+// so the stream ages the hot lines out of it; an inclusive `upper` then
+// back-invalidates them in `lower` and the hot chase starts missing. Returns
+// how much slower the hot chase gets.
+double measure_back_invalidation(volatile uint8_t *arr, int cache_line_size,
+                                 CacheLevel const &lower,
+                                 CacheLevel const &upper) {
+  uint64_t hot_size = lower.size / INCLUSION_HOT_FRACTION;
+  uint64_t stream_size = INCLUSION_STREAM_FACTOR * upper.size;
+  auto hot = (uint8_t *)arr;
+  auto stream = hot + hot_size;
+  generate_random_chain(arr, cache_line_size, hot_size);
+
+  auto measure_case = [&](bool chase_hot, bool read_stream) {
+    auto point = point_tag(std::string("hot_set_") + lower.name + "_" +
+                               upper.name,
+                           chase_hot, read_stream);
+    return measure(point, [&]() {
+      return benchmark_hot_set(hot, hot_size, stream, stream_size,
+                               cache_line_size, chase_hot, read_stream);
+    });
+  };
+  std::cerr << "\nHot set of " << hot_size << " bytes alone" << std::endl;
+  double hot_only = measure_case(true, false);
+  std::cerr << "\nStream of " << stream_size << " bytes alone" << std::endl;
+  double stream_only = measure_case(false, true);
+  std::cerr << "\nHot set and stream" << std::endl;
+  double both = measure_case(true, true);
+
+  uint64_t n_hot_accesses = INCLUSION_STREAM_PASSES * stream_size /
+                            (INCLUSION_STREAM_LINES * cache_line_size) *
+                            (hot_size / cache_line_size);
+  double hot_ns = hot_only / n_hot_accesses;
+  double streamed_hot_ns = (both - stream_only) / n_hot_accesses;
+  print_result(std::string("back_invalidation_") + lower.name + "_" +
+                   upper.name,
+               1,
+               make_result(cache_line_size, hot_size, streamed_hot_ns, hot_ns));
+  return streamed_hot_ns / hot_ns;
+}
+
+void find_inclusion_policy(volatile uint8_t *arr, int cache_line_size,
+                           CacheLevel const &lower, CacheLevel const &upper) {
+  uint64_t capacity =
+      find_effective_capacity(arr, cache_line_size, lower, upper);
+  if (capacity == 0) {
+    return;
+  }
+  std::cerr << "Result: " << lower.name << "+" << upper.name
+            << " effective capacity is " << capacity << std::endl;
+  const char *policy;
+  if (capacity >= upper.size + lower.size / 2) {
+    policy = "exclusive";
+  } else if (measure_back_invalidation(arr, cache_line_size, lower, upper) >=
+             BACK_INVALIDATION_RATIO) {
+    policy = "inclusive";
+  } else {
+    policy = "non-inclusive non-exclusive";
+  }
+  std::cerr << "Result: " << upper.name << " is " << policy << " of "
+            << lower.name << std::endl;
+}
+
+void run_inclusion_mode() {
+  auto arr = allocate_array();
+  print_csv_header();
+  int cache_line_size = get_cache_line_size();
+  auto levels = get_cache_levels();
+  for (size_t i = 0; i + 1 < levels.size(); i++) {
+    find_inclusion_policy(arr, cache_line_size, levels[i], levels[i + 1]);
+  }
+}
+
+// Runs the chain for about N_ACCESSES jumps and scales the time to exactly
+// N_ACCESSES, so that the rows compare with the data-side latency rows
+long long benchmark_code_chain(CodeChain chain, uint64_t n_blocks) {
+  uint64_t n_loops = std::max(N_ACCESSES / n_blocks, 1UL);
+  auto start = std::chrono::steady_clock::now();
+  chain(n_loops);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  return elapsed_ns * N_ACCESSES / (n_loops * n_blocks);
+}
+
+// Code counterpart of run_benchmarks: `arr_size` is the footprint of the
+// generated chain and `stride` the distance between its jumps
+std::vector<BenchmarkResult>
+run_code_benchmarks(uint8_t *code,
+                    std::vector<BenchmarkParameters> const &parameters_sequence,
+                    bool randomize) {
+  std::vector<BenchmarkResult> results;
+  double prev_result = 1.0;
+  for (BenchmarkParameters param : parameters_sequence) {
+    std::cerr << "\nCode stride = " << param.stride
+              << ", footprint = " << param.arr_size << std::endl;
+    uint64_t n_blocks = param.arr_size / param.stride;
+    auto chain = generate_code_chain(code, JIT_ARENA_LENGTH, param.stride,
+                                     n_blocks, randomize);
+    double current_result =
+        measure(point_tag("icache", param.stride, param.arr_size),
+                [&]() { return benchmark_code_chain(chain, n_blocks); });
+    BenchmarkResult benchmark_result;
+    benchmark_result.parameters = param;
+    benchmark_result.result = current_result;
+    benchmark_result.increase = current_result / prev_result;
+    results.push_back(benchmark_result);
+
+    print_result("icache", 1, benchmark_result);
+    prev_result = current_result;
+  }
+  return results;
+}
+
+// Footprint of the last point below the midpoint between the first and the
+// last point, in blocks. Frontend stalls ramp up over several points instead
+// of jumping at once, so the midpoint is steadier than the first spike.
+uint64_t find_blocks_before_knee(std::vector<BenchmarkResult> const &results) {
+  double first = results.front().result;
+  double last = results.back().result;
+  if (last < ICACHE_JUMP_RATIO * first) {
+    return 0;
+  }
+  double threshold = first + ICACHE_KNEE_FRACTION * (last - first);
+  size_t knee = 0;
+  while (knee + 1 < results.size() && results[knee + 1].result < threshold) {
+    knee++;
+  }
+  auto const &params = results[knee].parameters;
+  return params.arr_size / params.stride;
+}
+
+int find_icache_line(uint8_t *code) {
+  auto params = get_strides_parameters_sequence(
+      MIN_CACHELINE_SIZE, MAX_CACHELINE_SIZE, ICACHE_LINE_FOOTPRINT);
+  auto results = run_code_benchmarks(code, params, false);
+  return find_first_performance_spike(results);
+}
+
+// Blocks are visited in random order so that the next-line instruction
+// prefetcher cannot hide the misses
+uint64_t find_icache_size(uint8_t *code, int cache_line_size) {
+  auto params = get_sizes_parameters_sequence(
+      cache_line_size, MIN_ICACHE_SIZE, MAX_ICACHE_SIZE, ICACHE_SIZE_STEP);
+  auto results = run_code_benchmarks(code, params, true);
+  return find_blocks_before_knee(results) * cache_line_size;
+}
+
+// Same aliasing trick as find_associativity, with jumps instead of loads
+uint64_t find_icache_associativity(uint8_t *code, int cache_line_size) {
+  int stride = cache_line_size * MAX_N_SETS;
+  std::vector<BenchmarkParameters> parameters_sequence;
+  for (uint64_t n_blocks = 2; n_blocks <= 2 * ICACHE_MAX_WAYS; n_blocks++) {
+    parameters_sequence.push_back(
+        {.stride = stride, .arr_size = n_blocks * stride});
+  }
+  auto results = run_code_benchmarks(code, parameters_sequence, false);
+  return find_blocks_before_knee(results);
+}
+
+// One jump per page, shifted by a line per page like the data-side TLB chain
+uint64_t find_itlb_entries(uint8_t *code, int cache_line_size) {
+  int stride = get_tlb_stride(sysconf(_SC_PAGE_SIZE), 1, cache_line_size);
+  std::vector<BenchmarkParameters> parameters_sequence;
+  for (uint64_t n_pages = TLB_MIN_PAGES;
+       n_pages <= TLB_MAX_PAGES && n_pages * stride <= JIT_ARENA_LENGTH;
+       n_pages += n_pages / 4) {
+    parameters_sequence.push_back(
+        {.stride = stride, .arr_size = n_pages * stride});
+  }
+  auto results = run_code_benchmarks(code, parameters_sequence, true);
+  return find_blocks_before_knee(results);
+}
+
+void run_icache_mode() {
+  auto code = allocate_code(JIT_ARENA_LENGTH);
+  print_csv_header();
+
+  int cache_line_size = find_icache_line(code);
+  if (cache_line_size == -1) {
+    cache_line_size = get_cache_line_size();
+    std::cerr << "Could not detect L1i line size, assuming "
+              << cache_line_size << std::endl;
+  }
+  std::cerr << "Result: L1i line size is " << cache_line_size << std::endl;
+
+  uint64_t cache_size = find_icache_size(code, cache_line_size);
+  std::cerr << "Result: L1i size is " << cache_size << std::endl;
+
+  uint64_t associativity = find_icache_associativity(code, cache_line_size);
+  std::cerr << "Result: L1i associativity is " << associativity << std::endl;
+
+  uint64_t itlb_entries = find_itlb_entries(code, cache_line_size);
+  std::cerr << "Result: iTLB reach is " << itlb_entries << " pages"
+            << std::endl;
+
+  std::cerr << std::endl
+            << "L1i line size:     " << cache_line_size << std::endl
+            << "L1i size:          " << cache_size << std::endl
+            << "L1i associativity: " << associativity << std::endl
+            << "iTLB entries:      " << itlb_entries << std::endl;
+}
+
+struct NumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+
+// Nodes with memory; the ones without CPUs get an empty CPU list. Hosts
+// without NUMA support in the kernel look like a single node 0. Only CPUs of
+// the affinity mask are listed, so a cpuset that excludes a node's CPUs
+// turns it into a memory-only node.
+std::vector<NumaNode> get_numa_nodes() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  auto allowed_cpus = [&](std::vector<int> cpus) {
+    std::erase_if(cpus, [&](int cpu) {
+      return cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed);
+    });
+    return cpus;
+  };
+  std::string memory_nodes = read_file(NODES_SYSFS_DIR "/has_memory");
+  if (memory_nodes.empty()) {
+    std::vector<int> all_cpus;
+    for (int cpu = 0; cpu < (int)std::thread::hardware_concurrency(); cpu++) {
+      all_cpus.push_back(cpu);
+    }
+    return {{0, allowed_cpus(all_cpus)}};
+  }
+  std::vector<NumaNode> nodes;
+  for (int id : parse_list(memory_nodes)) {
+    std::string cpus = read_file(std::string(NODES_SYSFS_DIR "/node") +
+                                 std::to_string(id) + "/cpulist");
+    nodes.push_back({id, allowed_cpus(parse_list(cpus))});
+  }
+  return nodes;
+}
+
+// Maps `length` bytes whose pages may only come from `node`. Calls mbind
+// directly so that libnuma is not needed.
+volatile uint8_t *allocate_on_node(uint64_t length, int node) {
+  void *arr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (arr == MAP_FAILED) {
+    std::cerr << "Failed to map " << length << " bytes" << std::endl;
+    std::exit(1);
+  }
+  unsigned long nodemask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = {};
+  nodemask[node / (8 * sizeof(unsigned long))] |=
+      1UL << (node % (8 * sizeof(unsigned long)));
+  if (syscall(SYS_mbind, arr, length, MPOL_BIND, nodemask, NUMA_MAX_NODES + 1,
+              MPOL_MF_STRICT) != 0) {
+    std::cerr << "Failed to bind " << length << " bytes to node " << node
+              << std::endl;
+    std::exit(1);
+  }
+  std::fill_n((volatile uint8_t *)arr, length, (uint8_t)0);
+  std::cerr << "Allocated array of " << length << " bytes on node " << node
+            << std::endl;
+  return (uint8_t *)arr;
+}
+
+struct NumaCell {
+  double latency_ns;
+  double bandwidth;
+};
+
+// Latency of a random DRAM chase from one CPU of `cpu_node` and read
+// bandwidth with one thread per CPU of `cpu_node`, both over memory that
+// lives on the node `arr` was bound to
+NumaCell measure_numa_cell(volatile uint8_t *arr, int cache_line_size,
+                           NumaNode const &cpu_node, int memory_node) {
+  std::string suffix = "_cpu" + std::to_string(cpu_node.id) + "_mem" +
+                       std::to_string(memory_node);
+  NumaCell cell;
+  pin_to_cpus({cpu_node.cpus[0]});
+  std::cerr << "\nLatency from node " << cpu_node.id << " to node "
+            << memory_node << std::endl;
+  generate_random_chain(arr, cache_line_size, NUMA_ARR_LENGTH);
+  double latency = measure_benchmark(
+      point_tag("numa_latency" + suffix, cache_line_size, NUMA_ARR_LENGTH),
+      arr);
+  cell.latency_ns = to_ns_per_access(latency);
+  print_result("numa_latency" + suffix, 1,
+               make_result(cache_line_size, NUMA_ARR_LENGTH, latency, latency));
+
+  pin_to_cpus(cpu_node.cpus);
+  int n_threads = cpu_node.cpus.size();
+  // benchmark_bandwidth starts each thread on a page boundary, so whole
+  // pages keep the last thread inside the arena
+  long page_size = sysconf(_SC_PAGE_SIZE);
+  uint64_t arr_size = NUMA_ARR_LENGTH / n_threads / page_size * page_size;
+  uint64_t n_passes = std::max(BANDWIDTH_BYTES_PER_RUN / arr_size, 1UL);
+  std::cerr << "\nBandwidth from node " << cpu_node.id << " to node "
+            << memory_node << std::endl;
+  auto point = point_tag("numa_read" + suffix, n_threads, arr_size);
+  double elapsed_ns = measure(point, [&]() {
+    return benchmark_bandwidth(arr, bandwidth_read, arr_size, n_passes,
+                               n_threads);
+  });
+  cell.bandwidth = (double)arr_size * n_passes * n_threads / elapsed_ns;
+  print_result("numa_read" + suffix, n_threads,
+               make_result(BANDWIDTH_ACCESS_SIZE, arr_size, cell.bandwidth,
+                           cell.bandwidth));
+  return cell;
+}
+
+void print_numa_matrix(std::vector<NumaNode> const &cpu_nodes,
+                       std::vector<NumaNode> const &memory_nodes,
+                       std::vector<std::vector<NumaCell>> const &matrix) {
+  std::cerr << std::endl << "CPU node \\ memory node: ns, GB/s" << std::endl;
+  for (size_t i = 0; i < cpu_nodes.size(); i++) {
+    std::cerr << "node " << cpu_nodes[i].id << ":";
+    for (size_t j = 0; j < memory_nodes.size(); j++) {
+      std::cerr << "\t" << matrix[i][j].latency_ns << ", "
+                << matrix[i][j].bandwidth;
+    }
+    std::cerr << std::endl;
+  }
+}
+
+void run_numa_mode() {
+  print_csv_header();
+  int cache_line_size = get_cache_line_size();
+  auto memory_nodes = get_numa_nodes();
+  std::vector<NumaNode> cpu_nodes;
+  std::copy_if(memory_nodes.begin(), memory_nodes.end(),
+               std::back_inserter(cpu_nodes),
+               [](NumaNode const &node) { return !node.cpus.empty(); });
+
+  std::vector<std::vector<NumaCell>> matrix(
+      cpu_nodes.size(), std::vector<NumaCell>(memory_nodes.size()));
+  // Every cell pins this thread to its CPU node
+  cpu_set_t affinity = get_affinity();
+  for (size_t j = 0; j < memory_nodes.size(); j++) {
+    auto arr = allocate_on_node(NUMA_ARR_LENGTH, memory_nodes[j].id);
+    for (size_t i = 0; i < cpu_nodes.size(); i++) {
+      matrix[i][j] = measure_numa_cell(arr, cache_line_size, cpu_nodes[i],
+                                       memory_nodes[j].id);
+    }
+    munmap((void *)arr, NUMA_ARR_LENGTH);
+  }
+  restore_affinity(affinity);
+  print_numa_matrix(cpu_nodes, memory_nodes, matrix);
+}
+
+long long benchmark_dram_pair(uint8_t *a, uint8_t *b) {
+  auto start = std::chrono::steady_clock::now();
+  auto acc = dram_pair_access(a, b, DRAM_PAIR_ITERATIONS);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+// Inside one huge page virtual and physical addresses share their low bits,
+// so flipping one of them moves the second access to a known physical
+// address. Column bits keep the pair in one row, bank bits spread it over
+// two banks and row bits that feed no bank function make it conflict.
+void find_dram_row_conflicts(volatile uint8_t *arr) {
+  int max_bit = std::bit_width((uint64_t)HUGE_PAGE_SIZE) - 1;
+  std::vector<BenchmarkResult> results;
+  for (int bit = DRAM_MIN_BIT; bit < max_bit; bit++) {
+    auto a = (uint8_t *)arr;
+    auto b = a + ((uint64_t)1 << bit);
+    std::cerr << "\nDRAM pair differing in bit " << bit << std::endl;
+    auto point = point_tag("dram_pair", 1 << bit, 2 << bit);
+    double ns = measure(point, [&]() {
+                  return benchmark_dram_pair(a, b);
+                }) /
+                DRAM_PAIR_ITERATIONS;
+    results.push_back(make_result(1 << bit, 2 << bit, ns,
+                                  results.empty() ? ns : results[0].result));
+    print_result("dram_pair_bit" + std::to_string(bit), 1, results.back());
+  }
+
+  auto [fastest, slowest] = std::minmax_element(
+      results.begin(), results.end(),
+      [](auto const &a, auto const &b) { return a.result < b.result; });
+  double threshold = fastest->result + ROW_CONFLICT_FRACTION *
+                                           (slowest->result - fastest->result);
+  auto flipped_bit = [](BenchmarkResult const &result) {
+    return std::bit_width((uint64_t)result.parameters.stride) - 1;
+  };
+  // The lowest bit is a column bit on every mapping we know of
+  auto const &same_row = results.front();
+  std::cerr << std::endl
+            << "Result: same row pair takes " << same_row.result << " ns"
+            << std::endl
+            << "Result: different banks pair takes " << fastest->result
+            << " ns (bit " << flipped_bit(*fastest) << ")" << std::endl
+            << "Result: same bank, different rows pair takes "
+            << slowest->result << " ns (bit " << flipped_bit(*slowest) << ")"
+            << std::endl;
+  std::cerr << "Result: row conflict bits:";
+  for (auto const &result : results) {
+    if (result.result >= threshold) {
+      std::cerr << " " << flipped_bit(result);
+    }
+  }
+  std::cerr << std::endl;
+}
+
+struct BackgroundLoad {
+  std::atomic<bool> stop = false;
+  std::atomic<uint64_t> n_bytes = 0;
+  std::chrono::steady_clock::time_point start;
+  std::vector<std::thread> threads;
+};
+
+// Starts `n_threads` threads that stream through their own `region_size`
+// bytes of `arr` until stop_background_load. Unless `bytes_per_second` is 0,
+// each thread spins after every chunk until it is back under that rate, the
+// way MLC throttles its load generators.
+void start_background_load(BackgroundLoad &load, volatile uint8_t *arr,
+                           uint64_t region_size, int n_threads,
+                           double bytes_per_second = 0) {
+  load.stop = false;
+  load.n_bytes = 0;
+  load.start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n_threads; i++) {
+    load.threads.emplace_back([&load, arr, region_size, bytes_per_second, i]() {
+      auto region = (uint8_t *)arr + i * region_size;
+      uint64_t acc = 0;
+      uint64_t position = 0;
+      uint64_t n_bytes = 0;
+      auto start = std::chrono::steady_clock::now();
+      while (!load.stop) {
+        acc ^= bandwidth_read(region + position, BACKGROUND_CHUNK_SIZE, 1);
+        position = (position + BACKGROUND_CHUNK_SIZE) % region_size;
+        n_bytes += BACKGROUND_CHUNK_SIZE;
+        if (bytes_per_second != 0) {
+          auto due = start + std::chrono::nanoseconds((long long)(
+                                 n_bytes / bytes_per_second * 1e9));
+          while (std::chrono::steady_clock::now() < due && !load.stop) {
+          }
+        }
+      }
+      load.n_bytes += n_bytes;
+      std::cerr << "background acc=" << acc << std::endl;
+    });
+  }
+}
+
+// Stops the threads and returns the bandwidth they achieved together, GB/s
+double stop_background_load(BackgroundLoad &load) {
+  load.stop = true;
+  for (auto &thread : load.threads) {
+    thread.join();
+  }
+  load.threads.clear();
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - load.start)
+          .count();
+  return (double)load.n_bytes / elapsed_ns;
+}
+
+long long benchmark_loaded_chase(volatile uint8_t *arr) {
+  auto start = std::chrono::steady_clock::now();
+  auto acc = scalar_chase((uint8_t *)arr, LOADED_N_ACCESSES);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+struct LoadedPoint {
+  double latency_ns;
+  double bandwidth;
+};
+
+// Chase latency over the chain at the start of `arr` while `n_streams`
+// threads read `load_arr` at `bytes_per_second` each, 0 meaning as fast as
+// they can. The bandwidth is checkpointed next to the latency, since a
+// replayed chase leaves the load no time to run.
+LoadedPoint measure_loaded_point(std::string const &name,
+                                 volatile uint8_t *arr,
+                                 volatile uint8_t *load_arr,
+                                 uint64_t region_size, int n_streams,
+                                 double bytes_per_second) {
+  auto chase_point = point_tag(name, n_streams, bytes_per_second);
+  auto load_point = point_tag(name + "_load", n_streams, bytes_per_second);
+  LoadedPoint point;
+  if (will_replay(0, chase_point) && will_replay(1, load_point)) {
+    point.latency_ns = replay_next() / LOADED_N_ACCESSES;
+    point.bandwidth = replay_next();
+    return point;
+  }
+  // Neither half is replayed alone
+  discard_unreplayed();
+  BackgroundLoad load;
+  start_background_load(load, load_arr, region_size, n_streams,
+                        bytes_per_second);
+  point.latency_ns = measure(chase_point, [&]() {
+                       return benchmark_loaded_chase(arr);
+                     }) /
+                     LOADED_N_ACCESSES;
+  point.bandwidth = stop_background_load(load);
+  record_result(load_point, point.bandwidth);
+  return point;
+}
+
+// Random DRAM chase latency while 0, 1, 2, 4, ... other threads stream
+// through the rest of the buffer
+void find_loaded_dram_latency(volatile uint8_t *arr, uint64_t arr_length,
+                              int cache_line_size) {
+  int max_streams = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+  uint64_t region_size = (arr_length - LOADED_CHASE_LENGTH) / max_streams /
+                         BACKGROUND_CHUNK_SIZE * BACKGROUND_CHUNK_SIZE;
+  generate_random_chain(arr, cache_line_size, LOADED_CHASE_LENGTH);
+  // Doubling from none, and every other CPU busy at the end, which is the
+  // point the curve is for even if it is no power of two
+  std::vector<int> stream_counts = {0};
+  for (int n_streams = 1; n_streams < max_streams; n_streams *= 2) {
+    stream_counts.push_back(n_streams);
+  }
+  stream_counts.push_back(max_streams);
+  double idle_ns = 0;
+  for (int n_streams : stream_counts) {
+    std::cerr << "\nDRAM chase with " << n_streams << " streams" << std::endl;
+    double ns = measure_loaded_point("dram_loaded_latency", arr,
+                                     arr + LOADED_CHASE_LENGTH, region_size,
+                                     n_streams, 0)
+                    .latency_ns;
+    if (idle_ns == 0) {
+      idle_ns = ns;
+    }
+    print_result("dram_loaded_latency", n_streams + 1,
+                 make_result(cache_line_size, LOADED_CHASE_LENGTH, ns,
+                             idle_ns));
+    std::cerr << "Result: DRAM latency with " << n_streams << " streams is "
+              << ns << " ns" << std::endl;
+  }
+}
+
+void run_dram_mode() {
+  print_csv_header();
+  int cache_line_size = get_cache_line_size();
+  auto arr = allocate_pages(TLB_ARENA_LENGTH, true);
+  find_dram_row_conflicts(arr);
+  find_loaded_dram_latency(arr, TLB_ARENA_LENGTH, cache_line_size);
+}
+
+// MLC-style loaded latency: for every level, one point without load, one
+// unthrottled and LOADED_N_RATES in between at evenly spaced fractions of
+// the unthrottled bandwidth
+void find_loaded_latency_curve(volatile uint8_t *arr, int cache_line_size,
+                               std::string const &level_name,
+                               uint64_t chase_size, int n_streams) {
+  auto load_arr = arr + LOADED_CHASE_LENGTH;
+  uint64_t region_size = (ARR_LENGTH - LOADED_CHASE_LENGTH) / n_streams /
+                         BACKGROUND_CHUNK_SIZE * BACKGROUND_CHUNK_SIZE;
+  generate_random_chain(arr, cache_line_size, chase_size);
+
+  std::cerr << "\n" << level_name << " chase without load" << std::endl;
+  std::string name = "loaded_latency_" + level_name;
+  auto idle = measure_loaded_point(name, arr, load_arr, region_size, 0, 0);
+  std::cerr << "\n" << level_name << " chase with unthrottled load"
+            << std::endl;
+  auto peak =
+      measure_loaded_point(name, arr, load_arr, region_size, n_streams, 0);
+
+  std::vector<LoadedPoint> points = {idle};
+  for (int i = 1; i <= LOADED_N_RATES; i++) {
+    double bandwidth = peak.bandwidth * i / (LOADED_N_RATES + 1);
+    std::cerr << "\n" << level_name << " chase with load of " << bandwidth
+              << " GB/s" << std::endl;
+    points.push_back(measure_loaded_point(name, arr, load_arr, region_size,
+                                          n_streams,
+                                          bandwidth * 1e9 / n_streams));
+  }
+  points.push_back(peak);
+
+  for (auto const &point : points) {
+    print_result("loaded_latency_" + level_name, n_streams + 1,
+                 make_result(cache_line_size, chase_size, point.latency_ns,
+                             idle.latency_ns));
+    print_result("loaded_bandwidth_" + level_name, n_streams,
+                 make_result(BANDWIDTH_ACCESS_SIZE, region_size,
+                             point.bandwidth, peak.bandwidth));
+    std::cerr << "Result: " << level_name << " latency is "
+              << point.latency_ns << " ns at " << point.bandwidth << " GB/s"
+              << std::endl;
+  }
+}
+
+void run_loaded_mode() {
+  auto arr = allocate_array();
+  print_csv_header();
+  int cache_line_size = get_cache_line_size();
+  int n_streams = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+  for (auto const &level : get_cache_levels()) {
+    find_loaded_latency_curve(arr, cache_line_size, level.name,
+                              level.size / 2, n_streams);
+  }
+  find_loaded_latency_curve(arr, cache_line_size, "DRAM", LOADED_CHASE_LENGTH,
+                            n_streams);
+}
+
+// Everything that changes what the benchmarks measure: the CPU and its
+// microcode, the kernel and the frequency policy
+std::string get_host_description() {
+  std::map<std::string, std::string> cpuinfo;
+  std::ifstream file("/proc/cpuinfo");
+  std::string line;
+  // The first processor is enough, the fields repeat for every CPU
+  while (std::getline(file, line) && !line.empty()) {
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    size_t key_end = line.find_last_not_of(" \t", colon - 1) + 1;
+    std::string key = line.substr(0, key_end);
+    cpuinfo[key] = colon + 2 < line.size() ? line.substr(colon + 2) : "";
+  }
+  utsname host;
+  uname(&host);
+  std::string cpufreq = CPUFREQ_SYSFS_DIR;
+  return cpuinfo["model name"] + ";" + cpuinfo["microcode"] + ";" +
+         host.machine + ";" + host.release + ";" +
+         read_file(cpufreq + "/scaling_driver") + ";" +
+         read_file(cpufreq + "/scaling_governor") + ";" +
+         read_file(cpufreq + "/scaling_min_freq") + ";" +
+         read_file(cpufreq + "/scaling_max_freq") + ";" +
+         read_file("/sys/devices/system/cpu/intel_pstate/no_turbo") + ";" +
+         read_file("/sys/devices/system/cpu/cpufreq/boost");
+}
+
+// FNV-1a hash of the host description
+std::string get_host_fingerprint(std::string const &description) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : description) {
+    hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+  }
+  std::ostringstream fingerprint;
+  fingerprint << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return fingerprint.str();
+}
+
+// The database is an append-only file of "fingerprint,key,value" lines, so
+// that concurrent runs never corrupt each other and old hosts stay
+// available. Later lines override earlier ones.
+struct ResultsDb {
+  std::string path;
+  std::string fingerprint;
+  std::map<std::string, double> values;
+};
+
+// What geometry mode stores in the database
+const char *GEOMETRY_KEYS[] = {"cache_line_size", "cache_size",
+                               "associativity"};
+
+ResultsDb open_results_db(std::string const &path) {
+  ResultsDb db;
+  db.path = path;
+  std::string description = get_host_description();
+  db.fingerprint = get_host_fingerprint(description);
+  std::cerr << "Host " << db.fingerprint << ": " << description << std::endl;
+
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t first = line.find(',');
+    size_t second = line.rfind(',');
+    if (first == second || line.substr(0, first) != db.fingerprint) {
+      continue;
+    }
+    // A run killed mid-write leaves a torn last line
+    try {
+      db.values[line.substr(first + 1, second - first - 1)] =
+          std::stod(line.substr(second + 1));
+    } catch (std::exception const &) {
+    }
+  }
+  return db;
+}
+
+void store_result(ResultsDb &db, std::string const &key, double value) {
+  std::ofstream file(db.path, std::ios::app);
+  file << std::setprecision(std::numeric_limits<double>::max_digits10)
+       << db.fingerprint << "," << key << "," << value << std::endl;
+  if (!file) {
+    std::cerr << "Failed to write to " << db.path << std::endl;
+  }
+  db.values[key] = value;
+}
+
+// The value stored for this host, or a fresh measurement that is stored
+// for the next run unless `store` is false
+double lookup_or_measure(ResultsDb &db, std::string const &key,
+                         bool remeasure,
+                         std::function<double()> const &measure,
+                         bool store = true) {
+  auto it = db.values.find(key);
+  if (!remeasure && it != db.values.end()) {
+    std::cerr << "Cached: " << key << " is " << it->second << std::endl;
+    emit_detection(key, {it->second, NAN, NAN, NAN}, true);
+    return it->second;
+  }
+  double value = measure();
+  if (store) {
+    store_result(db, key, value);
+  }
+  return value;
+}
+
+struct Options {
+  std::string mode = "geometry";
+  std::string db_path = RESULTS_DB_PATH;
+  bool remeasure = false;
+  std::string checkpoint_path;
+  bool resume = false;
+  std::string ndjson_path;
+  // 0 for no budget
+  int budget_ms = 0;
+  bool parallel = false;
+  // smt only: empty for every workload in turn
+  std::string sibling_load;
+  // Binary logs, written by every mode but convert, which reads them
+  std::string log_path;
+  std::string trace_path;
+  // report only: which result files to read and where the HTML goes
+  std::string report_filter;
+  std::string report_path = REPORT_PATH;
+  // compare only: substrings that select the files of each result set
+  std::string baseline;
+  std::string candidate;
+};
+
+// Everything needed to tell runs apart and to reproduce them
+void emit_run_metadata(Options const &options) {
+  std::string description = get_host_description();
+  JsonObject run;
+  add(run, "type", "run");
+  add(run, "mode", options.mode);
+  add(run, "host", get_host_fingerprint(description));
+  add(run, "host_description", description);
+  add(run, "n_cpus", std::thread::hardware_concurrency());
+  add(run, "compiler", __VERSION__);
+  add(run, "build_flags", BUILD_FLAGS);
+  // Budgeted geometry runs and probe time with the TSC
+  bool budgeted = options.budget_ms > 0 || options.mode == "probe";
+  add(run, "timer", budgeted ? "rdtsc" : "std::chrono::steady_clock");
+  add(run, "timer_resolution_ns",
+      1e9 * std::chrono::steady_clock::period::num /
+          std::chrono::steady_clock::period::den);
+  add(run, "n_accesses", N_ACCESSES);
+  add(run, "precision_percent", PRECISION);
+  add(run, "required_converged_runs", REQUIRED_N_CONVERGED_RUNS);
+  add(run, "max_runs", TOTAL_RUNS_THRESHOLD);
+  add(run, "n_workers", scheduler.cpus.size());
+  // With several workers, the points up to this size run at all-core turbo
+  // and the rest at single-core turbo
+  add(run, "parallel_max_size",
+      scheduler.cpus.size() > 1 ? (double)scheduler.private_cache_size : NAN);
+  // Set index bits are only probed within one huge page
+  if (options.mode == "sets") {
+    add(run, "last_probed_address_bit",
+        std::countr_zero((uint64_t)HUGE_PAGE_SIZE) - 1);
+  }
+  emit(run);
+}
+
+// A full run stops if a phase finds nothing, or finds nonsense. A budgeted
+// one settles for what the OS reports, or the default where it reports
+// nothing, like libcachegeom does, and adds `key` to `from_os`.
+double require_detected(double detected, std::string const &key,
+                        double os_value, std::set<std::string> &from_os) {
+  if (detected > 0) {
+    return detected;
+  }
+  if (measurement.policy != MeasurementPolicy::Budget) {
+    std::exit(1);
+  }
+  std::cerr << "Using the " << key << " reported by the OS, not measured: "
+            << os_value << std::endl;
+  emit_detection(key, {os_value, NAN, NAN, NAN}, false, false);
+  from_os.insert(key);
+  return os_value;
+}
+
+// Gives the next phase `share` percent of the budget, counted from the
+// deadline of the previous phase
+void start_budget_phase(std::chrono::milliseconds budget, int share) {
+  measurement.phase_deadline +=
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          budget * share / 100);
+}
+
+void print_geometry(int cache_line_size, uint64_t cache_size,
+                    int associativity, std::set<std::string> const &from_os) {
+  auto mark = [&](std::string const &key) {
+    return from_os.contains(key) ? " (from OS)" : "";
+  };
+  std::cerr << std::endl
+            << "Cache line size: " << cache_line_size
+            << mark("cache_line_size") << std::endl
+            << "Cache size:      " << cache_size << mark("cache_size")
+            << std::endl
+            << "Associativity:   " << associativity << mark("associativity")
+            << std::endl;
+}
+
+// With --budget-ms the points are sampled under Budget, with the TSC and
+// libcachegeom's shares of what calibration, results.db and the arena left
+// of the budget. The estimates come with their ranges and are too rough to
+// be stored in results.db. Unlike probe mode, which is
+// the library call a program would make, the run is still a geometry run:
+// it reuses what results.db holds, prints rows and reports every sample.
+void run_geometry_mode(Options const &options) {
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::milliseconds budget(options.budget_ms);
+  bool budgeted = options.budget_ms > 0;
+  if (budgeted) {
+    measurement.policy = MeasurementPolicy::Budget;
+    measurement.tsc_per_ns = calibrate_tsc();
+  }
+  auto db = open_results_db(options.db_path);
+  // The arena is only worth allocating if something has to be measured
+  volatile uint8_t *arr = nullptr;
+  auto get_arr = [&]() {
+    if (arr == nullptr) {
+      arr = allocate_array(CACHEGEOM_ARENA_SIZE);
+    }
+    return arr;
+  };
+  std::chrono::milliseconds setup(0);
+  if (budgeted) {
+    bool measures = options.remeasure ||
+                    std::any_of(std::begin(GEOMETRY_KEYS),
+                                std::end(GEOMETRY_KEYS), [&](auto key) {
+                                  return !db.values.contains(key);
+                                });
+    // Allocated up front so that no phase pays for it
+    if (measures) {
+      get_arr();
+    }
+    auto now = std::chrono::steady_clock::now();
+    setup = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+    budget = std::max(budget - setup, std::chrono::milliseconds(0));
+    measurement.phase_deadline = now;
+  }
+
+  print_csv_header();
+
+  // Keys that a budgeted run had to take from the OS
+  std::set<std::string> from_os;
+  start_budget_phase(budget, CACHEGEOM_LINE_BUDGET_SHARE);
+  int cache_line_size = lookup_or_measure(
+      db, "cache_line_size", options.remeasure,
+      [&]() {
+        return require_detected(find_cache_line(get_arr()), "cache_line_size",
+                                get_cache_line_size(), from_os);
+      },
+      !budgeted);
+  std::cerr << "Result: cache line size is " << cache_line_size << std::endl;
+
+  start_budget_phase(budget, CACHEGEOM_SIZE_BUDGET_SHARE);
+  uint64_t cache_size = lookup_or_measure(
+      db, "cache_size", options.remeasure,
+      [&]() {
+        return require_detected(find_cache_size(get_arr(), cache_line_size),
+                                "cache_size", get_cache_levels()[0].size,
+                                from_os);
+      },
+      !budgeted);
+  std::cerr << "Result: cache size is " << cache_size << std::endl;
+
+  start_budget_phase(budget, 100 - CACHEGEOM_LINE_BUDGET_SHARE -
+                                 CACHEGEOM_SIZE_BUDGET_SHARE);
+  int associativity = lookup_or_measure(
+      db, "associativity", options.remeasure,
+      [&]() {
+        return require_detected(find_associativity(get_arr(), cache_line_size),
+                                "associativity", get_associativity(),
+                                from_os);
+      },
+      !budgeted);
+  std::cerr << "Result: associativity is " << associativity << std::endl;
+
+  print_geometry(cache_line_size, cache_size, associativity, from_os);
+  if (budgeted) {
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cerr << "Took " << elapsed.count() << " ms of a "
+              << options.budget_ms << " ms budget, " << setup.count()
+              << " ms of them to set up" << std::endl;
+    JsonObject spent;
+    add(spent, "type", "budget");
+    add(spent, "budget_ms", options.budget_ms);
+    add(spent, "setup_ms", setup.count());
+    add(spent, "elapsed_ms", elapsed.count());
+    emit(spent);
+  }
+}
+
+// Prints what the database holds for this host as "key,value" lines without
+// measuring anything, for services that size their data at startup. Fails
+// if the host was never measured.
+int run_lookup_mode(Options const &options) {
+  auto db = open_results_db(options.db_path);
+  if (db.values.empty()) {
+    std::cerr << "No results for host " << db.fingerprint << " in "
+              << options.db_path << std::endl;
+    return 1;
+  }
+  for (auto const &[key, value] : db.values) {
+    std::cout << key << "," << value << std::endl;
+  }
+  return 0;
+}
+
+long long benchmark_conflict_chase(volatile uint8_t *arr) {
+  auto start = std::chrono::steady_clock::now();
+  auto acc = scalar_chase((uint8_t *)arr, CONFLICT_N_ACCESSES);
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+// Chases half as many lines as `level` holds, spaced by every multiple of the
+// line size up to CONFLICT_MAX_STRIDE. The footprint never changes and the
+// chase never spans more than CONFLICT_MAX_HUGE_PAGES huge pages, which keeps
+// the TLB out of it, so any stride that is slower than the rest maps the
+// lines into too few sets. Each row's `increase` is relative to the
+// median stride; the rows of all strides make the heat map of the level.
+void find_conflict_strides(volatile uint8_t *arr, int cache_line_size,
+                           CacheLevel const &level) {
+  uint64_t n_nodes = level.size / cache_line_size / 2;
+  uint64_t max_span = std::min(
+      ARR_LENGTH, (uint64_t)CONFLICT_MAX_HUGE_PAGES * HUGE_PAGE_SIZE);
+  uint64_t max_stride =
+      std::min((uint64_t)CONFLICT_MAX_STRIDE, max_span / n_nodes);
+  if (max_stride < CONFLICT_MAX_STRIDE) {
+    std::cerr << level.name << ": strides above " << max_stride
+              << " would span more than " << max_span / HUGE_PAGE_SIZE
+              << " huge pages and are skipped" << std::endl;
+  }
+  std::vector<BenchmarkResult> results;
+  for (uint64_t stride = cache_line_size; stride <= max_stride;
+       stride += cache_line_size) {
+    std::cerr << "\n" << level.name << " footprint with stride " << stride
+              << std::endl;
+    generate_random_chain(arr, stride, n_nodes * stride);
+    auto point = point_tag(std::string("conflict_") + level.name, stride,
+                           n_nodes * cache_line_size);
+    double ns =
+        measure(point, [&]() { return benchmark_conflict_chase(arr); }) /
+        CONFLICT_N_ACCESSES;
+    results.push_back(make_result(stride, n_nodes * cache_line_size, ns, 0));
+  }
+
+  std::vector<double> latencies;
+  for (auto const &result : results) {
+    latencies.push_back(result.result);
+  }
+  std::nth_element(latencies.begin(),
+                   latencies.begin() + latencies.size() / 2, latencies.end());
+  double median_ns = latencies[latencies.size() / 2];
+  std::ostringstream pathological;
+  for (auto &result : results) {
+    result.increase = result.result / median_ns;
+    print_result(std::string("conflict_") + level.name, 1, result);
+    if (result.increase >= CONFLICT_SLOWDOWN_RATIO) {
+      pathological << " " << result.parameters.stride << " ("
+                   << result.increase << "x)";
+    }
+  }
+  std::cerr << "Result: " << level.name
+            << " pathological strides:" << pathological.str() << std::endl;
+}
+
+void run_conflict_mode() {
+  auto arr = allocate_pages(ARR_LENGTH, true);
+  print_csv_header();
+  int cache_line_size = get_cache_line_size();
+  for (auto const &level : get_cache_levels()) {
+    find_conflict_strides(arr, cache_line_size, level);
+  }
+}
+
+// Builds an eviction set for the first line of `arr` out of lines
+// `pool_stride` bytes apart, all outside of its huge page, then flips the
+// address bits inside the huge page, which huge pages keep equal in the
+// virtual and the physical address. A bit whose flip escapes the set feeds
+// the set index or the slice hash. Two such bits that evict again when
+// flipped together are XORed into the same index bit. Bits from the huge
+// page size up are not contiguous physically and stay unknown.
+// Returns the reload ticks of an evicted line, which the next level needs,
+// or 0 if no eviction set was found.
+uint64_t find_set_index_bits(uint8_t *arr, int cache_line_size,
+                             CacheLevel const &level, int ways,
+                             uint64_t pool_stride, uint64_t upper_ticks,
+                             double tsc_per_ns) {
+  std::cerr << "\n" << level.name << " set index bits" << std::endl;
+  uint8_t *target = arr;
+  std::vector<uint8_t *> pool;
+  for (uint64_t offset = HUGE_PAGE_SIZE;
+       offset < SETS_ARENA_LENGTH && pool.size() < SETS_MAX_POOL;
+       offset += pool_stride) {
+    pool.push_back(arr + offset);
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto [lines, evicted_ticks, kept_ticks, threshold] = find_eviction_set(
+      pool, target, target + cache_line_size, upper_ticks, ways);
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (lines.empty()) {
+    std::cerr << "Could not build a minimal eviction set for " << level.name
+              << " out of " << pool.size() << " lines" << std::endl;
+    return 0;
+  }
+  std::cerr << "Reload takes " << kept_ticks << " ticks when kept and "
+            << evicted_ticks << " ticks when evicted" << std::endl
+            << "Eviction set of " << lines.size() << " lines built in "
+            << elapsed.count() << " ms" << std::endl;
+
+  auto probe_delta = [&](uint64_t delta) {
+    uint64_t ticks = probe_after_lines(target + delta, lines);
+    print_result(std::string("set_index_") + level.name, 1,
+                 make_result(delta, lines.size() * cache_line_size,
+                             ticks / tsc_per_ns, evicted_ticks / tsc_per_ns));
+    return ticks > threshold;
+  };
+  int first_bit = std::countr_zero((unsigned)cache_line_size);
+  int unknown_bit = std::countr_zero((uint64_t)HUGE_PAGE_SIZE);
+  std::vector<double> index_bits;
+  for (int bit = first_bit; bit < unknown_bit; bit++) {
+    if (!probe_delta((uint64_t)1 << bit)) {
+      index_bits.push_back(bit);
+    }
+  }
+  std::ostringstream bits, pairs;
+  std::vector<double> pair_bits;
+  for (size_t i = 0; i < index_bits.size(); i++) {
+    bits << " " << index_bits[i];
+    for (size_t j = i + 1; j < index_bits.size(); j++) {
+      if (probe_delta(((uint64_t)1 << (int)index_bits[i]) |
+                      ((uint64_t)1 << (int)index_bits[j]))) {
+        pairs << " " << index_bits[i] << "^" << index_bits[j];
+        pair_bits.insert(pair_bits.end(), {index_bits[i], index_bits[j]});
+      }
+    }
+  }
+  std::cerr << "Result: " << level.name << " index bits among bits "
+            << first_bit << " to " << unknown_bit - 1 << ":" << bits.str()
+            << std::endl
+            << "Result: " << level.name
+            << " bits XORed together:" << pairs.str() << std::endl
+            << "Result: " << level.name << " bits " << unknown_bit
+            << " and up are unknown, they are not contiguous physically"
+            << std::endl;
+  JsonObject result;
+  add(result, "type", "set_index_bits");
+  add(result, "level", level.name);
+  add(result, "first_probed_bit", first_bit);
+  add(result, "last_probed_bit", unknown_bit - 1);
+  add_raw(result, "index_bits", to_json(index_bits));
+  // Flattened pairs of bits, XORed together
+  add_raw(result, "xored_bits", to_json(pair_bits));
+  add_raw(result, "higher_bits_known", "false");
+  emit(result);
+  return evicted_ticks;
+}
+
+// L1 is indexed by the page offset on every core we know of, and a single
+// timed load cannot tell an L1 hit from an L2 hit reliably, so only the
+// levels below it are mapped. They are mapped top-down, each eviction set
+// having to be slower than a reload from the level above.
+void run_sets_mode() {
+  auto arr = (uint8_t *)allocate_pages(SETS_ARENA_LENGTH, true);
+  print_csv_header();
+  double tsc_per_ns = calibrate_tsc();
+  int cache_line_size = get_cache_line_size();
+  auto levels = get_cache_levels();
+  // Lines one way size apart share their set. Slices do not report their
+  // own geometry, but no LLC we know of indexes a slice with more bits than
+  // its L2 uses, so the L3 pool uses the L2 way size.
+  long l2_ways = sysconf(_SC_LEVEL2_CACHE_ASSOC);
+  long l3_ways = sysconf(_SC_LEVEL3_CACHE_ASSOC);
+  int ways[] = {0, l2_ways > 0 ? (int)l2_ways : DEFAULT_SETS_WAYS,
+                l3_ways > 0 ? (int)l3_ways : DEFAULT_SETS_WAYS};
+  uint64_t pool_stride =
+      std::clamp(std::bit_floor(levels[1].size / ways[1]),
+                 (uint64_t)sysconf(_SC_PAGE_SIZE), (uint64_t)HUGE_PAGE_SIZE);
+  uint64_t upper_ticks = 0;
+  for (size_t i = 1; i < levels.size() && (i == 1 || upper_ticks > 0); i++) {
+    upper_ticks =
+        find_set_index_bits(arr, cache_line_size, levels[i], ways[i],
+                            pool_stride, upper_ticks, tsc_per_ns);
+  }
+}
+
+struct TuneGeometry {
+  int cache_line_size;
+  uint64_t cache_size;
+  int associativity;
+};
+
+// What geometry mode stored for this host, and what the OS reports for
+// anything it did not
+TuneGeometry get_tune_geometry(Options const &options) {
+  auto db = open_results_db(options.db_path);
+  auto get = [&db](std::string const &key, double os_value) {
+    auto it = db.values.find(key);
+    std::cerr << key << " " << (it == db.values.end() ? "from OS" : "measured")
+              << std::endl;
+    return it == db.values.end() ? os_value : it->second;
+  };
+  return {
+      .cache_line_size =
+          (int)get("cache_line_size", get_cache_line_size()),
+      .cache_size = (uint64_t)get("cache_size", get_cache_levels()[0].size),
+      .associativity = (int)get("associativity", get_associativity()),
+  };
+}
+
+// Largest square tile that keeps `n_tiles` tiles of doubles in the cache.
+// Rows of a matrix whose row length is a multiple of the way size all map
+// to one set, so such a tile also cannot have more rows than there are ways.
+uint64_t get_tile_seed(TuneGeometry const &geometry, uint64_t n,
+                       int n_tiles) {
+  auto tile = (uint64_t)std::sqrt(geometry.cache_size /
+                                  (n_tiles * sizeof(double)));
+  uint64_t way_size = geometry.cache_size / geometry.associativity;
+  if (n * sizeof(double) % way_size == 0) {
+    tile = std::min(tile, (uint64_t)geometry.associativity);
+  }
+  return std::clamp(tile, (uint64_t)TUNE_MIN_BLOCK, n);
+}
+
+// Powers of two within TUNE_SEARCH_FACTOR of the seed, the seed itself and
+// `n`, which is the untiled kernel
+std::vector<uint64_t> get_tile_candidates(uint64_t seed, uint64_t n) {
+  std::vector<uint64_t> candidates = {seed, n};
+  for (uint64_t tile = TUNE_MIN_BLOCK; tile <= n; tile *= 2) {
+    if (tile * TUNE_SEARCH_FACTOR >= seed &&
+        tile <= seed * TUNE_SEARCH_FACTOR) {
+      candidates.push_back(tile);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+  return candidates;
+}
+
+long long benchmark_tuned(std::function<double()> const &kernel) {
+  auto start = std::chrono::steady_clock::now();
+  // >>> begin benchmark
+  double acc = kernel();
+  // <<< end benchmark
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cerr << "benchmark acc=" << acc << std::endl;
+  return elapsed_ns;
+}
+
+// Measures the kernel for every candidate parameter and reports each in ns
+// per element, with `increase` relative to `baseline`
+void tune(std::string const &name, std::vector<uint64_t> const &candidates,
+          uint64_t seed, uint64_t baseline, uint64_t footprint,
+          uint64_t n_elements,
+          std::function<long long(uint64_t)> const &run_kernel) {
+  std::vector<BenchmarkResult> results;
+  for (uint64_t candidate : candidates) {
+    std::cerr << "\n" << name << " with " << candidate << std::endl;
+    double ns = measure(point_tag(name, candidate, footprint),
+                        [&]() { return run_kernel(candidate); }) /
+                n_elements;
+    results.push_back(make_result(candidate, footprint, ns, 0));
+  }
+  auto result_of = [&](uint64_t parameter) {
+    return std::find_if(results.begin(), results.end(), [&](auto &result) {
+             return result.parameters.stride == (int)parameter;
+           })->result;
+  };
+  double baseline_ns = result_of(baseline);
+  for (auto &result : results) {
+    result.increase = result.result / baseline_ns;
+    print_result("autotune_" + name, 1, result);
+  }
+  auto best = std::min_element(
+      results.begin(), results.end(),
+      [](auto &a, auto &b) { return a.result < b.result; });
+  std::cerr << "Result: best " << name << " parameter is "
+            << best->parameters.stride << ", " << baseline_ns / best->result
+            << "x faster than " << baseline << " and "
+            << result_of(seed) / best->result << "x faster than the seed "
+            << seed << std::endl;
+}
+
+void tune_transpose(TuneGeometry const &geometry) {
+  uint64_t n = TUNE_TRANSPOSE_N;
+  std::vector<double> in(n * n), out(n * n);
+  std::iota(in.begin(), in.end(), 0.0);
+  uint64_t seed = get_tile_seed(geometry, n, 2);
+  tune("transpose", get_tile_candidates(seed, n), seed, n,
+       2 * n * n * sizeof(double), n * n, [&](uint64_t tile) {
+         return benchmark_tuned([&]() {
+           transpose_blocked(in.data(), out.data(), n, tile);
+           return out[1];
+         });
+       });
+}
+
+void tune_gemm(TuneGeometry const &geometry) {
+  uint64_t n = TUNE_GEMM_N;
+  std::vector<double> a(n * n, 1.0), b(n * n, 0.5), c(n * n, 0.0);
+  uint64_t seed = get_tile_seed(geometry, n, 3);
+  tune("gemm", get_tile_candidates(seed, n), seed, n,
+       3 * n * n * sizeof(double), n * n * n, [&](uint64_t tile) {
+         return benchmark_tuned([&]() {
+           gemm_blocked(a.data(), b.data(), c.data(), n, tile);
+           return c[0];
+         });
+       });
+}
 
+// Every partition of a pass needs its current line to stay cached, so the
+// fan-out is bounded by half the lines of the cache. The untiled baseline
+// partitions all key bits in one pass.
+void tune_radix(TuneGeometry const &geometry) {
+  uint64_t n = TUNE_RADIX_N;
+  std::vector<uint64_t> source(n), keys(n), scratch(n);
+  std::mt19937_64 generator(RANDOM_CHAIN_SEED);
+  std::generate(source.begin(), source.end(), generator);
+  uint64_t n_lines = geometry.cache_size / geometry.cache_line_size;
+  uint64_t seed =
+      std::clamp((int)std::bit_width(n_lines) - 2, 1, TUNE_RADIX_KEY_BITS);
+  std::vector<uint64_t> candidates(TUNE_RADIX_KEY_BITS);
+  std::iota(candidates.begin(), candidates.end(), 1);
+  tune("radix", candidates, seed, TUNE_RADIX_KEY_BITS,
+       2 * n * sizeof(uint64_t), n, [&](uint64_t bits_per_pass) {
+         std::copy(source.begin(), source.end(), keys.begin());
+         return benchmark_tuned([&]() {
+           return (double)*radix_partition(keys.data(), scratch.data(), n,
+                                           TUNE_RADIX_KEY_BITS,
+                                           bits_per_pass);
+         });
+       });
+}
+
+// Picks tile sizes and radix fan-out for the kernels in tune.cpp, searching
+// around what the measured geometry predicts
+void run_autotune_mode(Options const &options) {
+  auto geometry = get_tune_geometry(options);
+  std::cerr << "Tuning for " << geometry.cache_line_size << " byte lines, "
+            << geometry.cache_size << " bytes, " << geometry.associativity
+            << " ways" << std::endl;
+  print_csv_header();
+  tune_transpose(geometry);
+  tune_gemm(geometry);
+  tune_radix(geometry);
+}
+
+// Best-effort geometry from libcachegeom within the budget, the way a
+// service would get it at startup: no rows, samples or results.db, just the
+// values, their ranges and where they came from
+void run_probe_mode(Options const &options) {
+  auto geometry =
+      cachegeom::detect(std::chrono::milliseconds(
+          options.budget_ms > 0 ? options.budget_ms : PROBE_DEFAULT_BUDGET_MS));
+  auto describe = [](auto value, auto range, bool measured) {
+    std::ostringstream description;
+    description << value;
+    if (!measured) {
+      description << " (from OS)";
+    } else if (range.low != range.high) {
+      description << " (" << range.low << " to " << range.high << ")";
+    }
+    return description.str();
+  };
   std::cerr << std::endl
-            << "Cache line size: " << cache_line_size << std::endl
-            << "Cache size:      " << cache_size << std::endl
-            << "Associativity:   " << associativity << std::endl;
+            << "Cache line size: "
+            << describe(geometry.cache_line_size,
+                        geometry.cache_line_size_range,
+                        geometry.line_measured)
+            << std::endl
+            << "Cache size:      "
+            << describe(geometry.cache_size, geometry.cache_size_range,
+                        geometry.size_measured)
+            << std::endl
+            << "Associativity:   "
+            << describe(geometry.associativity, geometry.associativity_range,
+                        geometry.associativity_measured)
+            << std::endl
+            << "Took " << geometry.elapsed.count() / 1e6 << " ms"
+            << std::endl;
+  emit_detection("cache_line_size",
+                 {(double)geometry.cache_line_size,
+                  (double)geometry.cache_line_size_range.low,
+                  (double)geometry.cache_line_size_range.high, NAN},
+                 false, geometry.line_measured);
+  emit_detection("cache_size",
+                 {(double)geometry.cache_size,
+                  (double)geometry.cache_size_range.low,
+                  (double)geometry.cache_size_range.high, NAN},
+                 false, geometry.size_measured);
+  emit_detection("associativity",
+                 {(double)geometry.associativity,
+                  (double)geometry.associativity_range.low,
+                  (double)geometry.associativity_range.high, NAN},
+                 false, geometry.associativity_measured);
+}
+
+// Prints a binary log from --log=<path> or --trace=<path> as CSV
+int run_convert_mode(Options const &options) {
+  if (options.log_path.empty() == options.trace_path.empty()) {
+    std::cerr << "convert needs exactly one of --log=<path> and "
+                 "--trace=<path>"
+              << std::endl;
+    return 1;
+  }
+  bool is_trace = !options.trace_path.empty();
+  auto binlog = open_binlog(is_trace ? options.trace_path : options.log_path);
+  auto const &header = get_header(binlog);
+  auto expected_kind = is_trace ? BinlogKind::Trace : BinlogKind::Results;
+  auto expected_size = is_trace ? sizeof(TraceRecord) : sizeof(ResultRecord);
+  if (header.kind != expected_kind || header.record_size != expected_size) {
+    std::cerr << "Not a " << (is_trace ? "trace" : "results log")
+              << std::endl;
+    return 1;
+  }
+  std::cout << std::setprecision(std::numeric_limits<double>::max_digits10);
+  if (is_trace) {
+    std::cout << "chain,index,offset\n";
+    for (uint64_t i = 0; i < header.n_records; i++) {
+      auto record = (TraceRecord const *)get_record(binlog, i);
+      std::cout << record->point << "," << record->index << ","
+                << record->offset << "\n";
+    }
+  } else {
+    std::cout << "benchmark,threads,stride,arr_size,result,increase\n";
+    for (uint64_t i = 0; i < header.n_records; i++) {
+      auto record = (ResultRecord const *)get_record(binlog, i);
+      std::cout << record->benchmark << "," << record->threads << ","
+                << record->stride << "," << record->arr_size << ","
+                << record->result << "," << record->increase << "\n";
+    }
+  }
+  close_binlog(binlog);
+  return 0;
+}
+
+// Analyzes the results*.csv and results*.bin files in the working directory,
+// as research.ipynb did
+int run_report_mode(Options const &options) {
+  int n_files =
+      write_report(".", options.report_filter, options.report_path);
+  if (n_files < 0) {
+    return 1;
+  }
+  std::cerr << "Wrote a report on " << n_files << " result files to "
+            << options.report_path << std::endl;
+  return n_files > 0 ? 0 : 1;
+}
+
+// Flags the points that got significantly worse between two result sets,
+// such as the runs of a host before and after a BIOS, microcode or kernel
+// update. Points are sorted into levels by the cache sizes of this host, so
+// run it on the hardware that was measured. Fails if anything regressed.
+int run_compare_mode(Options const &options) {
+  if (options.baseline.empty() || options.candidate.empty()) {
+    std::cerr << "compare needs --baseline=<substring> and "
+                 "--candidate=<substring>"
+              << std::endl;
+    return 1;
+  }
+  std::vector<FootprintLevel> levels;
+  for (auto const &level : get_cache_levels()) {
+    levels.push_back({level.name, level.size});
+  }
+  int n_regressions = compare_results(".", options.baseline, options.candidate,
+                                      levels, get_cache_line_size());
+  return n_regressions == 0 ? 0 : 1;
+}
+
+// What the sibling hyperthread runs during the sweep: nothing, a loop that
+// never touches memory, or a read loop over as much data as L1 holds
+enum class SiblingLoad { None, Compute, L1 };
+
+const char *to_string(SiblingLoad load) {
+  switch (load) {
+  case SiblingLoad::None:
+    return "none";
+  case SiblingLoad::Compute:
+    return "compute";
+  case SiblingLoad::L1:
+    return "l1";
+  }
+  return "unknown";
+}
+
+// Two CPUs of the first core that runs more than one hardware thread, or
+// nothing if SMT is off or the affinity mask excludes every sibling
+std::vector<int> find_smt_siblings() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (!CPU_ISSET(cpu, &allowed)) {
+      continue;
+    }
+    for (int sibling :
+         parse_list(read_file(CPUS_SYSFS_DIR "/cpu" + std::to_string(cpu) +
+                              "/topology/thread_siblings_list"))) {
+      if (sibling != cpu && CPU_ISSET(sibling, &allowed)) {
+        return {cpu, sibling};
+      }
+    }
+  }
+  return {};
+}
+
+// Starts the sibling workload on `cpu`, reusing the loaded mode's stop flag
+void start_sibling_load(BackgroundLoad &load, SiblingLoad kind, int cpu,
+                        volatile uint8_t *arr, uint64_t l1_size) {
+  load.stop = false;
+  load.threads.emplace_back([&load, kind, cpu, arr, l1_size]() {
+    pin_to_cpus({cpu});
+    uint64_t acc = 0;
+    while (!load.stop) {
+      acc ^= kind == SiblingLoad::Compute
+                 ? cycle_loop(SMT_COMPUTE_CHUNK)
+                 : bandwidth_read((uint8_t *)arr, l1_size, 1);
+    }
+    std::cerr << "sibling acc=" << acc << std::endl;
+  });
+}
+
+// Reruns the cache size sweep of geometry mode on one hyperthread while its
+// sibling runs each workload. A compute-only sibling that already moves the
+// knee means L1 is split statically whenever both threads run; a knee that
+// only moves under the L1 workload means the threads compete for all of it.
+int run_smt_mode(Options const &options) {
+  std::vector<SiblingLoad> loads = {SiblingLoad::None, SiblingLoad::Compute,
+                                    SiblingLoad::L1};
+  if (!options.sibling_load.empty()) {
+    auto it = std::find_if(loads.begin(), loads.end(), [&](SiblingLoad load) {
+      return options.sibling_load == to_string(load);
+    });
+    if (it == loads.end()) {
+      std::cerr << "Unknown sibling load " << options.sibling_load
+                << ", expected one of: none, compute, l1" << std::endl;
+      return 1;
+    }
+    loads = {*it};
+  }
+  auto siblings = find_smt_siblings();
+  if (siblings.empty()) {
+    std::cerr << "No SMT siblings available on this host" << std::endl;
+    return 1;
+  }
+  std::cerr << "Chasing on CPU " << siblings[0] << ", loading CPU "
+            << siblings[1] << std::endl;
+  pin_to_cpus({siblings[0]});
+  auto arr = allocate_array(MAX_CACHESIZE);
+  uint64_t l1_size = get_cache_levels()[0].size;
+  auto load_arr = allocate_array(l1_size);
+  int cache_line_size = get_cache_line_size();
+  print_csv_header();
+
+  std::map<SiblingLoad, uint64_t> capacities;
+  double idle_latency = NAN;
+  for (SiblingLoad kind : loads) {
+    std::cerr << "\nSibling runs " << to_string(kind) << std::endl;
+    BackgroundLoad load;
+    if (kind != SiblingLoad::None) {
+      start_sibling_load(load, kind, siblings[1], load_arr, l1_size);
+    }
+    // The smallest footprint is a pure L1 hit latency
+    std::string name = std::string("smt_") + to_string(kind);
+    int stride = 2 * cache_line_size;
+    generate_chain(arr, stride, SMT_MIN_CACHESIZE);
+    double latency =
+        measure_benchmark(point_tag(name, stride, SMT_MIN_CACHESIZE), arr);
+    uint64_t capacity =
+        find_cache_size(arr, cache_line_size, SMT_MIN_CACHESIZE, name);
+    if (kind != SiblingLoad::None) {
+      load.stop = true;
+      load.threads[0].join();
+    }
+    if (kind == SiblingLoad::None || std::isnan(idle_latency)) {
+      idle_latency = latency;
+    }
+    capacities[kind] = capacity;
+    print_result(name, kind == SiblingLoad::None ? 1 : 2,
+                 make_result(stride, capacity, latency, idle_latency));
+    std::cerr << "Result: with a " << to_string(kind)
+              << " sibling, L1 holds " << capacity << " bytes and hits take "
+              << to_ns_per_access(latency) << " ns" << std::endl;
+  }
+
+  bool all_found = std::all_of(capacities.begin(), capacities.end(),
+                               [](auto const &entry) { return entry.second; });
+  if (capacities.size() == 3 && all_found) {
+    uint64_t idle = capacities[SiblingLoad::None];
+    std::cerr << "Result: L1 is "
+              << (capacities[SiblingLoad::Compute] < idle ? "statically"
+                  : capacities[SiblingLoad::L1] < idle    ? "dynamically"
+                                                          : "not")
+              << " partitioned between hyperthreads" << std::endl;
+  }
+  return 0;
+}
+
+// Usage: main [mode] [--remeasure] [--db=<path>] [--checkpoint=<path>]
+//             [--resume] [--ndjson=<path>] [--budget-ms=<ms>] [--parallel]
+//             [--sibling-load=<none|compute|l1>] [--log=<path>]
+//             [--trace=<path>] [--filter=<substring>] [--report=<path>]
+//             [--baseline=<substring>] [--candidate=<substring>]
+Options parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--remeasure") {
+      options.remeasure = true;
+    } else if (arg.starts_with("--db=")) {
+      options.db_path = arg.substr(std::string("--db=").size());
+    } else if (arg.starts_with("--checkpoint=")) {
+      options.checkpoint_path =
+          arg.substr(std::string("--checkpoint=").size());
+    } else if (arg == "--resume") {
+      options.resume = true;
+    } else if (arg.starts_with("--budget-ms=")) {
+      options.budget_ms =
+          std::stoi(arg.substr(std::string("--budget-ms=").size()));
+    } else if (arg.starts_with("--ndjson=")) {
+      options.ndjson_path = arg.substr(std::string("--ndjson=").size());
+    } else if (arg == "--parallel") {
+      options.parallel = true;
+    } else if (arg.starts_with("--log=")) {
+      options.log_path = arg.substr(std::string("--log=").size());
+    } else if (arg.starts_with("--trace=")) {
+      options.trace_path = arg.substr(std::string("--trace=").size());
+    } else if (arg.starts_with("--filter=")) {
+      options.report_filter = arg.substr(std::string("--filter=").size());
+    } else if (arg.starts_with("--report=")) {
+      options.report_path = arg.substr(std::string("--report=").size());
+    } else if (arg.starts_with("--baseline=")) {
+      options.baseline = arg.substr(std::string("--baseline=").size());
+    } else if (arg.starts_with("--candidate=")) {
+      options.candidate = arg.substr(std::string("--candidate=").size());
+    } else if (arg.starts_with("--sibling-load=")) {
+      options.sibling_load =
+          arg.substr(std::string("--sibling-load=").size());
+    } else if (arg.starts_with("--")) {
+      std::cerr << "Unknown option " << arg << std::endl;
+      std::exit(1);
+    } else {
+      options.mode = arg;
+    }
+  }
+  if (options.budget_ms > 0 && options.mode != "geometry" &&
+      options.mode != "probe") {
+    std::cerr << "--budget-ms is only supported by geometry and probe"
+              << std::endl;
+    std::exit(1);
+  }
+  // Budgeted points split what is left of their phase one after the other,
+  // workers that measure them side by side would each need a deadline
+  if (options.parallel && options.budget_ms > 0) {
+    std::cerr << "--parallel does not support --budget-ms" << std::endl;
+    std::exit(1);
+  }
+  // Workers chase arenas of their own from allocate_array(), which only the
+  // sweeps of these modes chase too. Others map their arenas with a page
+  // policy of their own, and smt needs the sibling of the measuring core.
+  if (options.parallel && options.mode != "geometry" &&
+      options.mode != "inclusion") {
+    std::cerr << "--parallel is only supported by geometry and inclusion"
+              << std::endl;
+    std::exit(1);
+  }
+  if (options.resume && options.checkpoint_path.empty()) {
+    std::cerr << "--resume needs --checkpoint=<path>" << std::endl;
+    std::exit(1);
+  }
+  return options;
+}
+
+int main(int argc, char **argv) {
+  Options options = parse_options(argc, argv);
+  std::string const &mode = options.mode;
+  if (options.parallel) {
+    scheduler = get_scheduler();
+    std::cerr << "Measuring private cache points on "
+              << scheduler.cpus.size() << " cores with "
+              << scheduler.private_cache_size << " bytes of private cache"
+              << std::endl;
+  }
+  if (!options.ndjson_path.empty()) {
+    ndjson.open(options.ndjson_path, std::ios::trunc);
+    if (!ndjson) {
+      std::cerr << "Failed to open " << options.ndjson_path << std::endl;
+      return 1;
+    }
+    emit_run_metadata(options);
+  }
+  if (!options.checkpoint_path.empty()) {
+    open_checkpoint(options.checkpoint_path, mode, options.resume);
+  }
+  if (mode == "convert") {
+    return run_convert_mode(options);
+  }
+  if (mode == "report") {
+    return run_report_mode(options);
+  }
+  if (mode == "compare") {
+    return run_compare_mode(options);
+  }
+  if (!options.log_path.empty()) {
+    results_log = create_binlog(options.log_path, BinlogKind::Results,
+                                sizeof(ResultRecord));
+  }
+  if (!options.trace_path.empty()) {
+    trace_log = create_binlog(options.trace_path, BinlogKind::Trace,
+                              sizeof(TraceRecord));
+  }
+  // Trims the logs however the mode ends
+  std::atexit(close_logs);
+  if (mode == "geometry") {
+    run_geometry_mode(options);
+  } else if (mode == "lookup") {
+    return run_lookup_mode(options);
+  } else if (mode == "probe") {
+    run_probe_mode(options);
+  } else if (mode == "autotune") {
+    run_autotune_mode(options);
+  } else if (mode == "tlb") {
+    run_tlb_mode();
+  } else if (mode == "bandwidth") {
+    run_bandwidth_mode();
+  } else if (mode == "simd") {
+    run_simd_mode();
+  } else if (mode == "split") {
+    run_split_mode();
+  } else if (mode == "ports") {
+    run_ports_mode();
+  } else if (mode == "store") {
+    run_store_mode();
+  } else if (mode == "inclusion") {
+    run_inclusion_mode();
+  } else if (mode == "icache") {
+    run_icache_mode();
+  } else if (mode == "numa") {
+    run_numa_mode();
+  } else if (mode == "dram") {
+    run_dram_mode();
+  } else if (mode == "loaded") {
+    run_loaded_mode();
+  } else if (mode == "conflict") {
+    run_conflict_mode();
+  } else if (mode == "sets") {
+    run_sets_mode();
+  } else if (mode == "smt") {
+    return run_smt_mode(options);
+  } else {
+    std::cerr << "Unknown mode " << mode
+              << ", expected one of: geometry, lookup, probe, autotune, tlb, "
+                 "bandwidth, simd, split, ports, store, inclusion, icache, "
+                 "numa, dram, loaded, conflict, sets, smt, convert, report, "
+                 "compare"
+              << std::endl;
+    return 1;
+  }
   return 0;
 }
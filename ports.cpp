@@ -0,0 +1,32 @@
+#include "ports.h"
+
+uint64_t load_throughput(uint8_t *arr, uint64_t const *offsets,
+                         uint64_t n_iterations) {
+  // Volatile keeps the loop-invariant loads inside the loop. Pairs of loads
+  // share an accumulator to stay within the general purpose registers.
+  auto ptr0 = (volatile uint64_t *)(arr + offsets[0]);
+  auto ptr1 = (volatile uint64_t *)(arr + offsets[1]);
+  auto ptr2 = (volatile uint64_t *)(arr + offsets[2]);
+  auto ptr3 = (volatile uint64_t *)(arr + offsets[3]);
+  auto ptr4 = (volatile uint64_t *)(arr + offsets[4]);
+  auto ptr5 = (volatile uint64_t *)(arr + offsets[5]);
+  auto ptr6 = (volatile uint64_t *)(arr + offsets[6]);
+  auto ptr7 = (volatile uint64_t *)(arr + offsets[7]);
+  uint64_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+  // Counting down keeps the bound out of memory
+  for (uint64_t i = n_iterations; i != 0; i--) {
+    acc0 ^= *ptr0 ^ *ptr1;
+    acc1 ^= *ptr2 ^ *ptr3;
+    acc2 ^= *ptr4 ^ *ptr5;
+    acc3 ^= *ptr6 ^ *ptr7;
+  }
+  return acc0 ^ acc1 ^ acc2 ^ acc3;
+}
+
+uint64_t cycle_loop(uint64_t n_iterations) {
+  asm volatile("1:\n\t"
+               "dec %0\n\t"
+               "jnz 1b"
+               : "+r"(n_iterations));
+  return n_iterations;
+}
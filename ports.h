@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+#define PORTS_N_LOADS 8
+
+// Issues PORTS_N_LOADS independent 8-byte loads per iteration, the j-th one
+// from `arr + offsets[j]`, for `n_iterations` iterations.
+uint64_t load_throughput(uint8_t *arr, uint64_t const *offsets,
+                         uint64_t n_iterations);
+
+// Spins for `n_iterations` iterations of a loop carried by a single
+// one-cycle dependency, so that its run time converts ns to core cycles.
+uint64_t cycle_loop(uint64_t n_iterations);
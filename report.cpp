@@ -0,0 +1,666 @@
+#include "report.h"
+#include "binlog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <tuple>
+#include <sstream>
+#include <vector>
+
+// A point that is this much worse than the one before is a breakpoint:
+// slower for times, lower for rates
+#define BREAKPOINT_RATIO 1.25
+
+// Parameters that span this factor are plotted on a log2 axis
+#define LOG_AXIS_SPAN 16
+
+#define CHART_WIDTH 920
+// The rest of the width holds the legend
+#define PLOT_WIDTH 720
+#define CHART_HEIGHT 360
+#define CHART_MARGIN 64
+#define N_Y_TICKS 5
+#define MAX_X_TICKS 24
+
+// A point changed if its runs differ at this significance level and by at
+// least this much, the precision every point converges to
+#define COMPARE_ALPHA 0.01
+#define COMPARE_MIN_CHANGE 0.01
+
+// Matplotlib's Set1, as the notebook used
+static const char *COLORS[] = {"#e41a1c", "#377eb8", "#4daf4a",
+                               "#984ea3", "#ff7f00", "#a65628",
+                               "#f781bf", "#999999"};
+
+struct Row {
+  std::string benchmark;
+  int threads;
+  double stride;
+  double arr_size;
+  double result;
+};
+
+// One benchmark of one file
+struct Series {
+  std::string label;
+  std::string x_name;
+  std::vector<double> x;
+  std::vector<double> result;
+  std::vector<double> normalized;
+  std::vector<double> derivative;
+  std::vector<size_t> breakpoints;
+  bool higher_is_better;
+};
+
+static std::vector<std::string> split(std::string const &line) {
+  std::vector<std::string> fields;
+  std::stringstream stream(line);
+  std::string field;
+  while (std::getline(stream, field, ',')) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+// Rows of a CSV with main's header. Lines that do not parse, like the ones
+// a failed run leaves behind, are skipped. Files from before the benchmark
+// and threads columns, headed stride,arr_size,result,increase, only hold
+// single-threaded latency rows.
+static std::vector<Row> read_csv(std::filesystem::path const &path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  std::map<std::string, size_t> columns;
+  auto header = split(line);
+  for (size_t i = 0; i < header.size(); i++) {
+    columns[header[i]] = i;
+  }
+  std::vector<Row> rows;
+  for (auto name : {"stride", "arr_size", "result"}) {
+    if (!columns.contains(name)) {
+      std::cerr << "Skipping " << path.string() << ": it has no " << name
+                << " column" << std::endl;
+      return rows;
+    }
+  }
+  while (std::getline(file, line)) {
+    auto fields = split(line);
+    if (fields.size() != header.size()) {
+      continue;
+    }
+    try {
+      rows.push_back({columns.contains("benchmark")
+                          ? fields[columns["benchmark"]]
+                          : "latency",
+                      columns.contains("threads")
+                          ? std::stoi(fields[columns["threads"]])
+                          : 1,
+                      std::stod(fields[columns["stride"]]),
+                      std::stod(fields[columns["arr_size"]]),
+                      std::stod(fields[columns["result"]])});
+    } catch (std::exception const &) {
+    }
+  }
+  return rows;
+}
+
+// Rows of a results binlog. A stray or truncated file is skipped with a
+// warning, as bad CSV lines are.
+static std::vector<Row> read_binlog(std::filesystem::path const &path) {
+  std::vector<Row> rows;
+  auto binlog = try_open_binlog(path.string());
+  if (!is_open(binlog)) {
+    std::cerr << "Skipping " << path.string() << std::endl;
+    return rows;
+  }
+  auto const &header = get_header(binlog);
+  if (header.kind == BinlogKind::Results &&
+      header.record_size == sizeof(ResultRecord)) {
+    for (uint64_t i = 0; i < header.n_records; i++) {
+      auto record = (ResultRecord const *)get_record(binlog, i);
+      rows.push_back({record->benchmark, record->threads,
+                      (double)record->stride, (double)record->arr_size,
+                      record->result});
+    }
+  }
+  close_binlog(binlog);
+  return rows;
+}
+
+// Splits the rows of one benchmark into sweeps, in which one parameter
+// stays fixed and the other grows, as geometry mode runs a stride sweep, a
+// size sweep and more under the same name
+static std::vector<std::vector<Row>>
+split_sweeps(std::vector<Row> const &rows) {
+  std::vector<std::vector<Row>> sweeps;
+  for (auto const &row : rows) {
+    bool continues = false;
+    if (!sweeps.empty()) {
+      auto const &sweep = sweeps.back();
+      auto const &first = sweep.front();
+      if (sweep.size() == 1) {
+        bool same_stride = row.stride == first.stride;
+        continues = same_stride != (row.arr_size == first.arr_size);
+      } else if (sweep[1].stride == first.stride) {
+        continues = row.stride == first.stride &&
+                    row.arr_size > sweep.back().arr_size;
+      } else {
+        continues = row.arr_size == first.arr_size &&
+                    row.stride > sweep.back().stride;
+      }
+    }
+    if (!continues) {
+      sweeps.emplace_back();
+    }
+    sweeps.back().push_back(row);
+  }
+  return sweeps;
+}
+
+// How many times worse the `i`-th point is than the one before
+static double get_worsening(Series const &series, size_t i) {
+  return series.higher_is_better ? series.result[i - 1] / series.result[i]
+                                 : series.result[i] / series.result[i - 1];
+}
+
+// The parameter that changes is the x axis: stride in stride sweeps,
+// arr_size in size sweeps
+static Series make_series(std::string const &label,
+                          std::vector<Row> const &rows,
+                          bool higher_is_better) {
+  Series series;
+  series.label = label;
+  series.higher_is_better = higher_is_better;
+  bool fixed_stride = std::all_of(rows.begin(), rows.end(), [&](Row const &r) {
+    return r.stride == rows[0].stride;
+  });
+  series.x_name = fixed_stride ? "arr_size" : "stride";
+  for (auto const &row : rows) {
+    if (std::isfinite(row.result)) {
+      series.x.push_back(fixed_stride ? row.arr_size : row.stride);
+      series.result.push_back(row.result);
+    }
+  }
+  size_t n = series.x.size();
+  for (size_t i = 0; i < n; i++) {
+    series.normalized.push_back(series.result[i] / series.result[n - 1]);
+    series.derivative.push_back(
+        i == 0 ? 0
+               : (series.result[i] - series.result[i - 1]) /
+                     (series.x[i] - series.x[i - 1]));
+    if (i > 0 && get_worsening(series, i) >= BREAKPOINT_RATIO) {
+      series.breakpoints.push_back(i);
+    }
+  }
+  return series;
+}
+
+static std::string escape(std::string const &text) {
+  std::string escaped;
+  for (char c : text) {
+    switch (c) {
+    case '&':
+      escaped += "&amp;";
+      break;
+    case '<':
+      escaped += "&lt;";
+      break;
+    case '>':
+      escaped += "&gt;";
+      break;
+    case '"':
+      escaped += "&quot;";
+      break;
+    default:
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+// Byte counts read better in KiB and MiB
+static std::string format(double value) {
+  std::ostringstream text;
+  if (value >= 1024 && std::fmod(value, 1024 * 1024) == 0) {
+    text << value / (1024 * 1024) << "M";
+  } else if (value >= 1024 && std::fmod(value, 1024) == 0) {
+    text << value / 1024 << "K";
+  } else {
+    text << std::setprecision(4) << value;
+  }
+  return text.str();
+}
+
+// One line per series of `y` against its x, breakpoints drawn larger
+static void write_chart(std::ostream &html, std::string const &title,
+                        std::vector<Series> const &all_series,
+                        std::vector<double> Series::*y) {
+  double x_min = INFINITY, x_max = -INFINITY;
+  double y_min = INFINITY, y_max = -INFINITY;
+  for (auto const &series : all_series) {
+    for (size_t i = 0; i < series.x.size(); i++) {
+      if (std::isfinite((series.*y)[i])) {
+        x_min = std::min(x_min, series.x[i]);
+        x_max = std::max(x_max, series.x[i]);
+        y_min = std::min(y_min, (series.*y)[i]);
+        y_max = std::max(y_max, (series.*y)[i]);
+      }
+    }
+  }
+  if (!std::isfinite(x_min)) {
+    return;
+  }
+  if (y_max == y_min) {
+    y_max = y_min + 1;
+  }
+  bool log_x = x_min > 0 && x_max / x_min >= LOG_AXIS_SPAN;
+  auto scale_x = [&](double x) {
+    double position = log_x ? std::log2(x / x_min) / std::log2(x_max / x_min)
+                     : x_max == x_min ? 0.5
+                                      : (x - x_min) / (x_max - x_min);
+    return CHART_MARGIN + position * (PLOT_WIDTH - 2 * CHART_MARGIN);
+  };
+  auto scale_y = [&](double y) {
+    return CHART_HEIGHT - CHART_MARGIN -
+           (y - y_min) / (y_max - y_min) * (CHART_HEIGHT - 2 * CHART_MARGIN);
+  };
+
+  html << "<h3>" << escape(title) << "</h3>\n"
+       << "<svg width=\"" << CHART_WIDTH << "\" height=\"" << CHART_HEIGHT
+       << "\" font-size=\"11\">\n";
+  // Axes and ticks
+  html << "<line x1=\"" << CHART_MARGIN << "\" y1=\""
+       << CHART_HEIGHT - CHART_MARGIN << "\" x2=\""
+       << PLOT_WIDTH - CHART_MARGIN << "\" y2=\""
+       << CHART_HEIGHT - CHART_MARGIN << "\" stroke=\"black\"/>\n"
+       << "<line x1=\"" << CHART_MARGIN << "\" y1=\"" << CHART_MARGIN
+       << "\" x2=\"" << CHART_MARGIN << "\" y2=\""
+       << CHART_HEIGHT - CHART_MARGIN << "\" stroke=\"black\"/>\n";
+  for (int tick = 0; tick < N_Y_TICKS; tick++) {
+    double value = y_min + (y_max - y_min) * tick / (N_Y_TICKS - 1);
+    html << "<text x=\"" << CHART_MARGIN - 4 << "\" y=\"" << scale_y(value)
+         << "\" text-anchor=\"end\">" << value
+         << "</text>\n";
+  }
+  auto const &x_ticks = all_series[0].x;
+  size_t tick_step = std::max(x_ticks.size() / MAX_X_TICKS, (size_t)1);
+  for (size_t i = 0; i < x_ticks.size(); i += tick_step) {
+    double x = x_ticks[i];
+    html << "<text x=\"" << scale_x(x) << "\" y=\""
+         << CHART_HEIGHT - CHART_MARGIN + 14 << "\" "
+         << "transform=\"rotate(45 " << scale_x(x) << " "
+         << CHART_HEIGHT - CHART_MARGIN + 14 << ")\">" << format(x)
+         << "</text>\n";
+  }
+  html << "<text x=\"" << PLOT_WIDTH / 2 << "\" y=\"" << CHART_HEIGHT - 4
+       << "\" text-anchor=\"middle\">" << all_series[0].x_name
+       << (log_x ? " (log2)" : "") << "</text>\n";
+
+  for (size_t s = 0; s < all_series.size(); s++) {
+    auto const &series = all_series[s];
+    const char *color = COLORS[s % std::size(COLORS)];
+    html << "<polyline fill=\"none\" stroke=\"" << color << "\" points=\"";
+    for (size_t i = 0; i < series.x.size(); i++) {
+      if (std::isfinite((series.*y)[i])) {
+        html << scale_x(series.x[i]) << "," << scale_y((series.*y)[i]) << " ";
+      }
+    }
+    html << "\"/>\n";
+    for (size_t i = 0; i < series.x.size(); i++) {
+      if (!std::isfinite((series.*y)[i])) {
+        continue;
+      }
+      bool is_breakpoint =
+          std::find(series.breakpoints.begin(), series.breakpoints.end(),
+                    i) != series.breakpoints.end();
+      html << "<circle cx=\"" << scale_x(series.x[i]) << "\" cy=\""
+           << scale_y((series.*y)[i]) << "\" r=\"" << (is_breakpoint ? 5 : 2)
+           << "\" fill=\"" << color << "\"><title>" << escape(series.label)
+           << ": " << format(series.x[i]) << ", " << (series.*y)[i]
+           << "</title></circle>\n";
+    }
+    html << "<text x=\"" << PLOT_WIDTH - CHART_MARGIN + 8 << "\" y=\""
+         << CHART_MARGIN + 14 * s << "\" fill=\"" << color << "\">"
+         << escape(series.label) << "</text>\n";
+  }
+  html << "</svg>\n";
+}
+
+// results*.csv and results*.bin in `dir` whose name contains `filter`, in
+// name order
+static std::vector<std::filesystem::path>
+find_result_files(std::string const &dir, std::string const &filter) {
+  std::vector<std::filesystem::path> paths;
+  for (auto const &entry : std::filesystem::directory_iterator(dir)) {
+    std::string stem = entry.path().stem().string();
+    std::string extension = entry.path().extension().string();
+    if (entry.is_regular_file() && stem.starts_with("results") &&
+        stem.find(filter) != std::string::npos &&
+        (extension == ".csv" || extension == ".bin")) {
+      paths.push_back(entry.path());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+static std::vector<Row> read_results(std::filesystem::path const &path) {
+  return path.extension() == ".bin" ? read_binlog(path) : read_csv(path);
+}
+
+int write_report(std::string const &dir, std::string const &filter,
+                 std::string const &output) {
+  auto paths = find_result_files(dir, filter);
+
+  // Benchmark name to one series per file that has it
+  std::map<std::string, std::vector<Series>> benchmarks;
+  for (auto const &path : paths) {
+    auto rows = read_results(path);
+    std::map<std::string, std::vector<Row>> by_benchmark;
+    for (auto const &row : rows) {
+      by_benchmark[row.benchmark].push_back(row);
+    }
+    for (auto const &[benchmark, benchmark_rows] : by_benchmark) {
+      auto sweeps = split_sweeps(benchmark_rows);
+      for (size_t i = 0; i < sweeps.size(); i++) {
+        std::string name = sweeps.size() == 1
+                               ? benchmark
+                               : benchmark + ", sweep " + std::to_string(i + 1);
+        benchmarks[name].push_back(
+            make_series(path.stem().string(), sweeps[i],
+                        is_higher_better(benchmark)));
+      }
+    }
+  }
+
+  std::ofstream html(output, std::ios::trunc);
+  if (!html) {
+    std::cerr << "Failed to open " << output << std::endl;
+    return -1;
+  }
+  // Enough for the axis labels and the pixel coordinates alike
+  html << std::setprecision(4);
+  html << "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\">"
+       << "<title>Benchmark report</title><style>"
+       << "body{font-family:sans-serif}table{border-collapse:collapse}"
+       << "td,th{border:1px solid #ccc;padding:2px 8px}</style></head>"
+       << "<body>\n<h1>Benchmark report</h1>\n<p>" << paths.size()
+       << " result files. Breakpoints are points at least "
+       << BREAKPOINT_RATIO
+       << " times worse than the point before: slower, or lower for rates "
+          "like GB/s.</p>\n";
+  for (auto const &[benchmark, all_series] : benchmarks) {
+    html << "<h2>" << escape(benchmark) << "</h2>\n";
+    write_chart(html, "result", all_series, &Series::result);
+    write_chart(html, "result normalized by the last point", all_series,
+                &Series::normalized);
+    write_chart(html, "d result / d " + all_series[0].x_name, all_series,
+                &Series::derivative);
+    html << "<table><tr><th>file</th><th>breakpoints (" << all_series[0].x_name
+         << ", times worse)</th></tr>\n";
+    for (auto const &series : all_series) {
+      html << "<tr><td>" << escape(series.label) << "</td><td>";
+      for (size_t i : series.breakpoints) {
+        html << format(series.x[i]) << " (" << get_worsening(series, i)
+             << ") ";
+      }
+      html << "</td></tr>\n";
+    }
+    html << "</table>\n";
+  }
+  html << "</body></html>\n";
+  return paths.size();
+}
+
+bool is_higher_better(std::string const &benchmark) {
+  return std::any_of(std::begin(HIGHER_IS_BETTER), std::end(HIGHER_IS_BETTER),
+                     [&](std::string const &name) {
+                       return name.ends_with('_') ? benchmark.starts_with(name)
+                                                  : benchmark == name;
+                     });
+}
+
+// Bytes a point touches: a chase whose stride is a line or more touches one
+// line per node, anything denser all of `arr_size`
+static double get_footprint(double stride, double arr_size,
+                            int cache_line_size) {
+  return stride > cache_line_size ? arr_size / stride * cache_line_size
+                                  : arr_size;
+}
+
+// Continued fraction of the regularized incomplete beta function, after
+// Numerical Recipes
+static double beta_fraction(double a, double b, double x) {
+  const double tiny = 1e-300;
+  auto clamp_tiny = [tiny](double value) {
+    return std::fabs(value) < tiny ? tiny : value;
+  };
+  double c = 1;
+  double d = 1 / clamp_tiny(1 - (a + b) * x / (a + 1));
+  double h = d;
+  for (int m = 1; m <= 200; m++) {
+    double even = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+    d = 1 / clamp_tiny(1 + even * d);
+    c = clamp_tiny(1 + even / c);
+    h *= d * c;
+    double odd = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+    d = 1 / clamp_tiny(1 + odd * d);
+    c = clamp_tiny(1 + odd / c);
+    h *= d * c;
+    if (std::fabs(d * c - 1) < 1e-12) {
+      break;
+    }
+  }
+  return h;
+}
+
+static double incomplete_beta(double a, double b, double x) {
+  if (x <= 0 || x >= 1) {
+    return x <= 0 ? 0 : 1;
+  }
+  double front = std::exp(std::lgamma(a + b) - std::lgamma(a) -
+                          std::lgamma(b) + a * std::log(x) +
+                          b * std::log(1 - x));
+  return x < (a + 1) / (a + b + 2)
+             ? front * beta_fraction(a, b, x) / a
+             : 1 - front * beta_fraction(b, a, 1 - x) / b;
+}
+
+struct Comparison {
+  double baseline;
+  double candidate;
+  double change;
+  double effect_size;
+  double p_value;
+};
+
+static double get_mean(std::vector<double> const &values) {
+  return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+}
+
+static double get_variance(std::vector<double> const &values, double mean) {
+  double sum_of_squares = 0;
+  for (double value : values) {
+    sum_of_squares += (value - mean) * (value - mean);
+  }
+  return sum_of_squares / (values.size() - 1);
+}
+
+// Welch's t-test and Hedges' g of `candidate` against `baseline`. Both need
+// two runs or more; with fewer, only the means are filled in.
+static Comparison compare(std::vector<double> const &baseline,
+                          std::vector<double> const &candidate) {
+  Comparison comparison;
+  comparison.baseline = get_mean(baseline);
+  comparison.candidate = get_mean(candidate);
+  comparison.change = comparison.candidate / comparison.baseline - 1;
+  comparison.effect_size = NAN;
+  comparison.p_value = NAN;
+  size_t n_a = baseline.size(), n_b = candidate.size();
+  if (n_a < 2 || n_b < 2) {
+    return comparison;
+  }
+  double difference = comparison.candidate - comparison.baseline;
+  double var_a = get_variance(baseline, comparison.baseline);
+  double var_b = get_variance(candidate, comparison.candidate);
+  double error_a = var_a / n_a, error_b = var_b / n_b;
+  if (error_a + error_b == 0) {
+    comparison.p_value = difference == 0 ? 1 : 0;
+    comparison.effect_size =
+        difference == 0 ? 0 : std::copysign(INFINITY, difference);
+    return comparison;
+  }
+  double t = difference / std::sqrt(error_a + error_b);
+  double df = (error_a + error_b) * (error_a + error_b) /
+              (error_a * error_a / (n_a - 1) + error_b * error_b / (n_b - 1));
+  comparison.p_value = incomplete_beta(df / 2, 0.5, df / (df + t * t));
+  double pooled = std::sqrt(((n_a - 1) * var_a + (n_b - 1) * var_b) /
+                            (n_a + n_b - 2));
+  comparison.effect_size =
+      difference / pooled * (1 - 3.0 / (4 * (n_a + n_b) - 9));
+  return comparison;
+}
+
+typedef std::tuple<std::string, int, double, double> PointKey;
+
+// Every run's result of every point. A point that a file holds more than
+// once counts as the mean of its rows.
+static std::map<PointKey, std::vector<double>>
+read_runs(std::vector<std::filesystem::path> const &paths) {
+  std::map<PointKey, std::vector<double>> runs;
+  for (auto const &path : paths) {
+    std::map<PointKey, std::vector<double>> rows_of_run;
+    for (auto const &row : read_results(path)) {
+      if (std::isfinite(row.result)) {
+        rows_of_run[{row.benchmark, row.threads, row.stride, row.arr_size}]
+            .push_back(row.result);
+      }
+    }
+    for (auto const &[key, results] : rows_of_run) {
+      runs[key].push_back(get_mean(results));
+    }
+  }
+  return runs;
+}
+
+int compare_results(std::string const &dir, std::string const &baseline,
+                    std::string const &candidate,
+                    std::vector<FootprintLevel> const &levels,
+                    int cache_line_size) {
+  auto baseline_paths = find_result_files(dir, baseline);
+  auto candidate_paths = find_result_files(dir, candidate);
+  std::cerr << baseline_paths.size() << " baseline and "
+            << candidate_paths.size() << " candidate runs" << std::endl;
+  auto baseline_runs = read_runs(baseline_paths);
+  auto candidate_runs = read_runs(candidate_paths);
+  // read_csv and read_binlog already named every file they skipped
+  auto has_rows = [&](std::string const &name, std::string const &filter,
+                      auto const &paths, auto const &runs) {
+    if (paths.empty()) {
+      std::cerr << "No result file in " << dir << " matches the " << name
+                << " filter " << filter << std::endl;
+    } else if (runs.empty()) {
+      std::cerr << "None of the " << paths.size() << " " << name
+                << " files has a result row" << std::endl;
+    }
+    return !runs.empty();
+  };
+  bool baseline_has_rows =
+      has_rows("baseline", baseline, baseline_paths, baseline_runs);
+  bool candidate_has_rows =
+      has_rows("candidate", candidate, candidate_paths, candidate_runs);
+  if (!baseline_has_rows || !candidate_has_rows) {
+    return -1;
+  }
+
+  struct LevelSummary {
+    int n_points = 0;
+    int n_regressions = 0;
+    int n_improvements = 0;
+    std::vector<double> changes;
+  };
+  std::map<std::string, LevelSummary> summaries;
+  int n_regressions = 0;
+  std::cout << "benchmark,threads,stride,arr_size,level,n_baseline,"
+               "n_candidate,baseline,candidate,change_percent,effect_size,"
+               "p_value,verdict"
+            << std::endl;
+  for (auto const &[key, baseline_results] : baseline_runs) {
+    auto candidate_results = candidate_runs.find(key);
+    if (candidate_results == candidate_runs.end()) {
+      continue;
+    }
+    auto const &[benchmark, threads, stride, arr_size] = key;
+    std::string level = "DRAM";
+    double footprint = get_footprint(stride, arr_size, cache_line_size);
+    for (auto const &footprint_level : levels) {
+      if (footprint <= footprint_level.max_size) {
+        level = footprint_level.name;
+        break;
+      }
+    }
+    auto comparison = compare(baseline_results, candidate_results->second);
+    // Positive when the candidate is worse
+    double worsening = is_higher_better(benchmark) ? -comparison.change
+                                                   : comparison.change;
+    std::string verdict = "unchanged";
+    if (std::isnan(comparison.p_value)) {
+      verdict = "untested";
+    } else if (comparison.p_value < COMPARE_ALPHA &&
+               std::fabs(comparison.change) >= COMPARE_MIN_CHANGE) {
+      verdict = worsening > 0 ? "regression" : "improvement";
+    }
+    auto &summary = summaries[level];
+    summary.n_points++;
+    summary.changes.push_back(worsening);
+    if (verdict == "regression") {
+      summary.n_regressions++;
+      n_regressions++;
+      std::cerr << "Regression: " << benchmark << ", stride "
+                << (uint64_t)stride << ", arr_size " << (uint64_t)arr_size
+                << " is "
+                << 100 * std::fabs(comparison.change) << "% "
+                << (comparison.change > 0 ? "higher" : "lower")
+                << " (g = " << comparison.effect_size
+                << ", p = " << comparison.p_value << ")" << std::endl;
+    } else if (verdict == "improvement") {
+      summary.n_improvements++;
+    }
+    std::cout << benchmark << "," << threads << "," << (uint64_t)stride
+              << "," << (uint64_t)arr_size << "," << level << ","
+              << baseline_results.size() << ","
+              << candidate_results->second.size() << ","
+              << comparison.baseline << "," << comparison.candidate << ","
+              << 100 * comparison.change << "," << comparison.effect_size
+              << "," << comparison.p_value << "," << verdict << std::endl;
+  }
+
+  std::vector<std::string> level_names;
+  for (auto const &footprint_level : levels) {
+    level_names.push_back(footprint_level.name);
+  }
+  level_names.push_back("DRAM");
+  for (auto const &name : level_names) {
+    auto it = summaries.find(name);
+    if (it == summaries.end()) {
+      continue;
+    }
+    auto &summary = it->second;
+    std::nth_element(summary.changes.begin(),
+                     summary.changes.begin() + summary.changes.size() / 2,
+                     summary.changes.end());
+    std::cerr << "Result: " << name << ": " << summary.n_regressions
+              << " regressions and " << summary.n_improvements
+              << " improvements in " << summary.n_points
+              << " points, median worsening "
+              << 100 * summary.changes[summary.changes.size() / 2] << "%"
+              << std::endl;
+  }
+  return n_regressions;
+}
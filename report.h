@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Does what research.ipynb did, without Python: reads every results*.csv
+// and results*.bin log in `dir` whose name contains `filter`, normalizes
+// each benchmark's curve by its last point, differentiates it by its
+// parameter, marks the points where the result jumps and overlays all files
+// per benchmark, so that hosts can be compared. Writes one HTML file with
+// inline SVG charts to `output`. Returns the number of files read, or -1 if
+// the report could not be written.
+int write_report(std::string const &dir, std::string const &filter,
+                 std::string const &output);
+
+// Benchmarks whose result is a rate, GB/s or loads per cycle, so that
+// higher is better; every other result is a time. Entries that end in '_'
+// match every name they start, the others only that name.
+inline constexpr const char *HIGHER_IS_BETTER[] = {
+    "read",    "read_",      "write",             "rmw",
+    "copy",    "nt_write",   "numa_read_",        "loaded_bandwidth_",
+    "load_throughput",
+};
+
+bool is_higher_better(std::string const &benchmark);
+
+// Points that touch up to `max_size` bytes belong to `name`; more than the
+// last level is DRAM
+struct FootprintLevel {
+  std::string name;
+  uint64_t max_size;
+};
+
+// Compares two result sets, the files in `dir` selected by each filter as
+// for write_report, every file being one run. Points are aligned by
+// benchmark, threads, stride and arr_size, and the runs of each side are
+// compared with Welch's t-test; Hedges' g is the effect size. Prints one
+// CSV row per point to stdout and a summary per level of `levels`, to which
+// a point belongs by the bytes its `cache_line_size` lines cover. Returns
+// the number of significant regressions, or -1 if either set has no rows,
+// after printing which files were skipped and why.
+int compare_results(std::string const &dir, std::string const &baseline,
+                    std::string const &candidate,
+                    std::vector<FootprintLevel> const &levels,
+                    int cache_line_size);
@@ -0,0 +1,123 @@
+#include "simd.h"
+
+#include <immintrin.h>
+
+// The lowest lane of 512-bit vectors is read with a vector subscript: the cast
+// intrinsics trip -Wuninitialized inside the GCC 12 headers.
+
+// Both read kernels are unrolled by four vectors
+#define UNROLL_VECTORS 4
+
+bool simd_supports(int width) {
+  switch (width) {
+  case 8:
+    return true;
+  case 16:
+    return __builtin_cpu_supports("sse2");
+  case 32:
+    return __builtin_cpu_supports("avx2");
+  case 64:
+    return __builtin_cpu_supports("avx512f");
+  default:
+    return false;
+  }
+}
+
+uint64_t scalar_chase(uint8_t *start, uint64_t n_accesses) {
+  auto ptr = (uint64_t *)start;
+  for (uint64_t i = 0; i < n_accesses; i++) {
+    ptr = (uint64_t *)*(volatile uint64_t *)ptr;
+  }
+  return (uint64_t)ptr;
+}
+
+uint64_t simd_chase_16(uint8_t *start, uint64_t n_accesses) {
+  auto ptr = (__m128i *)start;
+  for (uint64_t i = 0; i < n_accesses; i++) {
+    ptr = (__m128i *)_mm_cvtsi128_si64(_mm_load_si128(ptr));
+  }
+  return (uint64_t)ptr;
+}
+
+__attribute__((target("avx2"))) uint64_t simd_chase_32(uint8_t *start,
+                                                       uint64_t n_accesses) {
+  auto ptr = (__m256i *)start;
+  for (uint64_t i = 0; i < n_accesses; i++) {
+    __m256i value = _mm256_load_si256(ptr);
+    ptr = (__m256i *)_mm_cvtsi128_si64(_mm256_castsi256_si128(value));
+  }
+  return (uint64_t)ptr;
+}
+
+__attribute__((target("avx512f"))) uint64_t simd_chase_64(uint8_t *start,
+                                                          uint64_t n_accesses) {
+  auto ptr = (__m512i *)start;
+  for (uint64_t i = 0; i < n_accesses; i++) {
+    __m512i value = _mm512_load_si512(ptr);
+    ptr = (__m512i *)value[0];
+  }
+  return (uint64_t)ptr;
+}
+
+// The lanes hold absolute addresses, so the gathers use a null base
+__attribute__((target("avx2"))) uint64_t gather_chase_32(uint8_t *start,
+                                                         uint64_t n_accesses) {
+  __m256i ptrs = _mm256_set1_epi64x((long long)start);
+  for (uint64_t i = 0; i < n_accesses; i++) {
+    ptrs = _mm256_i64gather_epi64((long long const *)nullptr, ptrs, 1);
+  }
+  return (uint64_t)_mm256_extract_epi64(ptrs, 0);
+}
+
+__attribute__((target("avx512f"))) uint64_t
+gather_chase_64(uint8_t *start, uint64_t n_accesses) {
+  __m512i ptrs = _mm512_set1_epi64((long long)start);
+  for (uint64_t i = 0; i < n_accesses; i++) {
+    ptrs = _mm512_mask_i64gather_epi64(ptrs, 0xFF, ptrs, nullptr, 1);
+  }
+  return (uint64_t)ptrs[0];
+}
+
+__attribute__((target("avx2"))) uint64_t
+simd_read_32(uint8_t *arr, uint64_t length, uint64_t n_passes) {
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  __m256i acc2 = _mm256_setzero_si256();
+  __m256i acc3 = _mm256_setzero_si256();
+  uint64_t step = UNROLL_VECTORS * sizeof(__m256i);
+  uint64_t end = length / step * step;
+  for (uint64_t pass = 0; pass < n_passes; pass++) {
+    for (uint64_t i = 0; i < end; i += step) {
+      auto ptr = (__m256i *)(arr + i);
+      acc0 = _mm256_xor_si256(acc0, _mm256_load_si256(ptr));
+      acc1 = _mm256_xor_si256(acc1, _mm256_load_si256(ptr + 1));
+      acc2 = _mm256_xor_si256(acc2, _mm256_load_si256(ptr + 2));
+      acc3 = _mm256_xor_si256(acc3, _mm256_load_si256(ptr + 3));
+    }
+  }
+  __m256i acc = _mm256_xor_si256(_mm256_xor_si256(acc0, acc1),
+                                 _mm256_xor_si256(acc2, acc3));
+  return (uint64_t)_mm256_extract_epi64(acc, 0);
+}
+
+__attribute__((target("avx512f"))) uint64_t
+simd_read_64(uint8_t *arr, uint64_t length, uint64_t n_passes) {
+  __m512i acc0 = _mm512_setzero_si512();
+  __m512i acc1 = _mm512_setzero_si512();
+  __m512i acc2 = _mm512_setzero_si512();
+  __m512i acc3 = _mm512_setzero_si512();
+  uint64_t step = UNROLL_VECTORS * sizeof(__m512i);
+  uint64_t end = length / step * step;
+  for (uint64_t pass = 0; pass < n_passes; pass++) {
+    for (uint64_t i = 0; i < end; i += step) {
+      auto ptr = (__m512i *)(arr + i);
+      acc0 = _mm512_xor_si512(acc0, _mm512_load_si512(ptr));
+      acc1 = _mm512_xor_si512(acc1, _mm512_load_si512(ptr + 1));
+      acc2 = _mm512_xor_si512(acc2, _mm512_load_si512(ptr + 2));
+      acc3 = _mm512_xor_si512(acc3, _mm512_load_si512(ptr + 3));
+    }
+  }
+  __m512i acc = _mm512_xor_si512(_mm512_xor_si512(acc0, acc1),
+                                 _mm512_xor_si512(acc2, acc3));
+  return (uint64_t)acc[0];
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Wide-load kernels for the simd mode. The 32- and 64-byte variants are
+// compiled for AVX2 and AVX-512F respectively and must only be called after
+// checking the CPU with simd_supports().
+bool simd_supports(int width);
+
+// The 8-byte chase of benchmark(), built with the same optimizations as the
+// wide ones so that the difference is the cost of the vector load only
+uint64_t scalar_chase(uint8_t *start, uint64_t n_accesses);
+
+// Pointer chases that load a whole `width`-byte vector per node and take the
+// next pointer from its lowest lane. `start` must be aligned to `width`.
+uint64_t simd_chase_16(uint8_t *start, uint64_t n_accesses);
+uint64_t simd_chase_32(uint8_t *start, uint64_t n_accesses);
+uint64_t simd_chase_64(uint8_t *start, uint64_t n_accesses);
+
+// Pointer chases where every lane of a gather follows the same chain, so
+// each step pays the full gather latency
+uint64_t gather_chase_32(uint8_t *start, uint64_t n_accesses);
+uint64_t gather_chase_64(uint8_t *start, uint64_t n_accesses);
+
+// Independent streaming loads, same contract as the kernels in bandwidth.h
+uint64_t simd_read_32(uint8_t *arr, uint64_t length, uint64_t n_passes);
+uint64_t simd_read_64(uint8_t *arr, uint64_t length, uint64_t n_passes);
@@ -0,0 +1,56 @@
+#include "store.h"
+
+uint64_t store_load_pair(uint8_t *store_ptr, uint8_t *load_ptr,
+                         uint64_t n_iterations) {
+  auto store = (volatile uint64_t *)store_ptr;
+  // The loaded word is zero, so the load address is always `load_ptr`, but
+  // every load depends on the previous one and puts the stall on the
+  // critical path
+  *(volatile uint64_t *)load_ptr = 0;
+  uint64_t value = 0;
+  for (uint64_t i = 0; i < n_iterations; i++) {
+    *store = value;
+    value = *(volatile uint64_t *)(load_ptr + value);
+  }
+  return value;
+}
+
+uint64_t store_forward_chain(uint8_t *ptr, uint64_t n_iterations) {
+  auto slot = (volatile uint64_t *)ptr;
+  uint64_t value = 0;
+  for (uint64_t i = 0; i < n_iterations; i++) {
+    *slot = value + 1;
+    value = *slot;
+  }
+  return value;
+}
+
+uint64_t store_burst(uint8_t *chain_a, uint8_t *chain_b, uint8_t *store_arr,
+                     uint64_t n_stores, uint64_t n_iterations) {
+  auto a = (volatile uint64_t *)chain_a;
+  auto b = (volatile uint64_t *)chain_b;
+  auto stores = (volatile uint64_t *)store_arr;
+  for (uint64_t i = 0; i < n_iterations; i++) {
+    a = (volatile uint64_t *)*a;
+    for (uint64_t j = 0; j < n_stores; j++) {
+      stores[j] = i;
+    }
+    b = (volatile uint64_t *)*b;
+  }
+  return (uint64_t)a ^ (uint64_t)b;
+}
+
+uint64_t read_lines(uint8_t *arr, uint64_t length, uint64_t line_size) {
+  uint64_t acc = 0;
+  for (uint64_t i = 0; i < length; i += line_size) {
+    acc ^= *(volatile uint64_t *)(arr + i);
+  }
+  return acc;
+}
+
+void write_lines(uint8_t *arr, uint64_t length, uint64_t line_size,
+                 uint64_t offset) {
+  for (uint64_t i = 0; i < length; i += line_size) {
+    *(volatile uint64_t *)(arr + i + offset) = i;
+  }
+}
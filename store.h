@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+// Stores `n_iterations` times to `store_ptr`, each time followed by a load
+// from `load_ptr` whose value feeds the next store and the next load address.
+// When the two addresses agree in their low 12 bits the load is falsely held
+// back by the store.
+uint64_t store_load_pair(uint8_t *store_ptr, uint8_t *load_ptr,
+                         uint64_t n_iterations);
+
+// Stores `n_iterations` times to `ptr` and loads the value right back, each
+// store taking the previously loaded value: one store-to-load forwarding
+// latency per iteration.
+uint64_t store_forward_chain(uint8_t *ptr, uint64_t n_iterations);
+
+// Advances two independent pointer chases by one node per iteration with
+// `n_stores` stores to `store_arr` between them. While the stores fit into
+// the store buffer the two loads overlap, once they do not the second load
+// waits for the first.
+uint64_t store_burst(uint8_t *chain_a, uint8_t *chain_b, uint8_t *store_arr,
+                     uint64_t n_stores, uint64_t n_iterations);
+
+// Touch the first word of every `line_size` bytes of `arr`, to pull lines
+// in clean or dirty
+uint64_t read_lines(uint8_t *arr, uint64_t length, uint64_t line_size);
+void write_lines(uint8_t *arr, uint64_t length, uint64_t line_size,
+                 uint64_t offset);
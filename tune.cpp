@@ -0,0 +1,63 @@
+#include "tune.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+void transpose_blocked(double const *in, double *out, uint64_t n,
+                       uint64_t block) {
+  for (uint64_t row = 0; row < n; row += block) {
+    for (uint64_t column = 0; column < n; column += block) {
+      uint64_t row_end = std::min(row + block, n);
+      uint64_t column_end = std::min(column + block, n);
+      for (uint64_t i = row; i < row_end; i++) {
+        for (uint64_t j = column; j < column_end; j++) {
+          out[j * n + i] = in[i * n + j];
+        }
+      }
+    }
+  }
+}
+
+void gemm_blocked(double const *a, double const *b, double *c, uint64_t n,
+                  uint64_t block) {
+  for (uint64_t i0 = 0; i0 < n; i0 += block) {
+    for (uint64_t k0 = 0; k0 < n; k0 += block) {
+      for (uint64_t j0 = 0; j0 < n; j0 += block) {
+        uint64_t i_end = std::min(i0 + block, n);
+        uint64_t k_end = std::min(k0 + block, n);
+        uint64_t j_end = std::min(j0 + block, n);
+        for (uint64_t i = i0; i < i_end; i++) {
+          for (uint64_t k = k0; k < k_end; k++) {
+            double a_ik = a[i * n + k];
+            for (uint64_t j = j0; j < j_end; j++) {
+              c[i * n + j] += a_ik * b[k * n + j];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+uint64_t *radix_partition(uint64_t *keys, uint64_t *scratch, uint64_t n,
+                          int key_bits, int bits_per_pass) {
+  std::vector<uint64_t> offsets;
+  for (int shift = 0; shift < key_bits; shift += bits_per_pass) {
+    int bits = std::min(bits_per_pass, key_bits - shift);
+    uint64_t mask = ((uint64_t)1 << bits) - 1;
+    offsets.assign(mask + 1, 0);
+    for (uint64_t i = 0; i < n; i++) {
+      offsets[(keys[i] >> shift) & mask]++;
+    }
+    uint64_t sum = 0;
+    for (auto &offset : offsets) {
+      sum += std::exchange(offset, sum);
+    }
+    for (uint64_t i = 0; i < n; i++) {
+      scratch[offsets[(keys[i] >> shift) & mask]++] = keys[i];
+    }
+    std::swap(keys, scratch);
+  }
+  return keys;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// Kernels for the autotuner. Each takes its tuning parameter last and does
+// the same work whatever its value.
+
+// out = in^T for `n` x `n` row-major matrices, `block` x `block` tiles at a
+// time
+void transpose_blocked(double const *in, double *out, uint64_t n,
+                       uint64_t block);
+
+// c += a * b for `n` x `n` row-major matrices, with all three loops tiled by
+// `block`
+void gemm_blocked(double const *a, double const *b, double *c, uint64_t n,
+                  uint64_t block);
+
+// Partitions the `n` keys of `keys` by their low `key_bits` bits in passes
+// of `bits_per_pass` bits each, least significant first, using `scratch` as
+// the other buffer. Returns the buffer that holds the result.
+uint64_t *radix_partition(uint64_t *keys, uint64_t *scratch, uint64_t n,
+                          int key_bits, int bits_per_pass);